@@ -0,0 +1,218 @@
+#include "analysis.h"
+#include <cstdlib>
+#include <set>
+#include <utility>
+
+namespace CHIP8 {
+
+    namespace {
+
+        /* Addresses execution may continue at after `ins`, located at `addr` */
+        std::vector<uint16_t> flow_successors(const Instruction& ins, uint16_t addr){
+            const uint16_t next = addr + 2;
+            switch(ins.op){
+                case Op::JP:
+                    return {ins.nnn};
+                case Op::CALL:
+                    return {ins.nnn, next}; // Subroutine, then return address
+                case Op::RET:
+                case Op::JP_V0:
+                case Op::EXIT: // SUPER-CHIP stops the program there
+                    return {};
+                case Op::SE_BYTE:
+                case Op::SNE_BYTE:
+                case Op::SE_REG:
+                case Op::SNE_REG:
+                case Op::SKP:
+                case Op::SKNP:
+                case Op::SAVE_RANGE: // 5xy0 without XO-CHIP
+                case Op::LOAD_RANGE:
+                case Op::LD_I_LONG:  // Followed by its address on XO-CHIP, ignored otherwise
+                    return {next, uint16_t(next + 2)};
+                default:
+                    return {next};
+            }
+        }
+
+        uint16_t read_opcode(const std::array<byte_t, RAM_SIZE>& ram, uint16_t addr){
+            return (ram[addr] << 8) | ram[addr + 1];
+        }
+    }
+
+    bool ends_block(Op op){
+        switch(op){
+            case Op::JP:
+            case Op::CALL:
+            case Op::RET:
+            case Op::JP_V0:
+            case Op::EXIT:
+            case Op::SE_BYTE:
+            case Op::SNE_BYTE:
+            case Op::SE_REG:
+            case Op::SNE_REG:
+            case Op::SKP:
+            case Op::SKNP:
+            case Op::SAVE_RANGE:
+            case Op::LOAD_RANGE:
+            case Op::LD_I_LONG:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    CodeMap analyse_code(const std::array<byte_t, RAM_SIZE>& ram, uint16_t entry, uint16_t limit){
+        CodeMap map;
+        map.instructions.fill(false);
+        auto in_range = [&](uint32_t addr){
+            return addr >= entry && addr + 2 <= limit && addr + 2 <= RAM_SIZE;
+        };
+
+        // Find every reachable instruction and the addresses blocks start at
+        std::set<uint16_t> leaders = {entry};
+        std::vector<uint16_t> pending = {entry};
+        while(!pending.empty()){
+            uint16_t addr = pending.back();
+            pending.pop_back();
+            if(!in_range(addr) || map.instructions[addr]){
+                continue;
+            }
+            map.instructions[addr] = true;
+
+            const Instruction ins = decode(read_opcode(ram, addr));
+            for(uint16_t next : flow_successors(ins, addr)){
+                if(ends_block(ins.op)){
+                    leaders.insert(next);
+                }
+                pending.push_back(next);
+            }
+        }
+
+        // Split the instructions into blocks at leaders and block-ending instructions
+        for(uint16_t start : leaders){
+            if(!in_range(start) || !map.instructions[start]){
+                continue;
+            }
+            BasicBlock block{start, start, {}, false};
+            uint16_t addr = start;
+            while(true){
+                const Instruction ins = decode(read_opcode(ram, addr));
+                const uint16_t next = addr + 2;
+                if(ends_block(ins.op)){
+                    block.end = next;
+                    block.successors = flow_successors(ins, addr);
+                    block.dynamic = (ins.op == Op::JP_V0);
+                    break;
+                }
+                if(!in_range(next) || leaders.count(next)){
+                    block.end = next;
+                    block.successors = {next};
+                    break;
+                }
+                addr = next;
+            }
+            map.blocks[start] = block;
+        }
+        return map;
+    }
+
+    ProgramMap analyse_program(const std::array<byte_t, RAM_SIZE>& ram, uint16_t entry, uint16_t limit){
+        ProgramMap map;
+        map.code = analyse_code(ram, entry, limit);
+        map.sprites.fill(false);
+        const CodeMap& code = map.code;
+        auto is_code = [&](uint32_t addr){
+            return addr < RAM_SIZE && (code.instructions[addr] || (addr > 0 && code.instructions[addr - 1]));
+        };
+
+        // Routines start at the entry point and at each call, and end at returns
+        std::vector<uint16_t> entries = {entry};
+        for(std::size_t i = 0; i != entries.size(); ++i){
+            if(map.routines.count(entries[i]) || !code.blocks.count(entries[i])){
+                continue;
+            }
+            Routine& routine = map.routines[entries[i]];
+            std::set<uint16_t> seen;
+            std::vector<uint16_t> pending = {entries[i]};
+            while(!pending.empty()){
+                const uint16_t start = pending.back();
+                pending.pop_back();
+                auto block = code.blocks.find(start);
+                if(block == code.blocks.end() || !seen.insert(start).second){
+                    continue;
+                }
+                const Instruction last = decode(read_opcode(ram, block->second.end - 2));
+                if(last.op == Op::CALL){
+                    routine.callees.insert(last.nnn);
+                    entries.push_back(last.nnn);
+                    pending.push_back(block->second.end);
+                } else {
+                    pending.insert(pending.end(), block->second.successors.begin(), block->second.successors.end());
+                }
+            }
+            routine.blocks.assign(seen.begin(), seen.end());
+        }
+
+        // Follow each path with the address in I, if known, visiting each pair once
+        constexpr int32_t UNKNOWN = -1;
+        std::set<std::pair<uint16_t, int32_t>> visited;
+        std::vector<std::pair<uint16_t, int32_t>> pending = {{entry, UNKNOWN}};
+        while(!pending.empty()){
+            const auto path = pending.back();
+            pending.pop_back();
+            const uint16_t addr = path.first;
+            int32_t I = path.second;
+            if(addr >= RAM_SIZE || !code.instructions[addr] || !visited.insert(path).second){
+                continue;
+            }
+
+            const Instruction ins = decode(read_opcode(ram, addr));
+            auto stores = [&](uint32_t size){
+                for(uint32_t i = 0; I != UNKNOWN && i != size; ++i){
+                    if(is_code(I + i)){
+                        map.self_modifying.insert(addr);
+                    }
+                }
+            };
+            switch(ins.op){
+                case Op::LD_I:
+                    I = ins.nnn;
+                    break;
+                case Op::DRW:
+                    for(uint32_t i = 0; I != UNKNOWN && i != (ins.n ? ins.n : 32u) && I + i < RAM_SIZE; ++i){
+                        map.sprites[I + i] = true;
+                    }
+                    break;
+                case Op::LD_BCD:
+                    stores(3);
+                    break;
+                case Op::LD_STORE:
+                    stores(ins.x + 1u);
+                    I = UNKNOWN; // Incremented by some quirks
+                    break;
+                case Op::SAVE_RANGE:
+                    stores(uint32_t(std::abs(ins.x - ins.y)) + 1u);
+                    break;
+                case Op::JP_V0:
+                    map.indirect_jumps.insert(addr);
+                    break;
+                case Op::ADD_I:
+                case Op::LD_FONT:
+                case Op::LD_HF:
+                case Op::LD_LOAD:
+                case Op::LD_I_LONG:
+                    I = UNKNOWN;
+                    break;
+                default:
+                    break;
+            }
+
+            for(uint16_t next : flow_successors(ins, addr)){
+                // The subroutine may change I before returning
+                const bool returned = (ins.op == Op::CALL && next == addr + 2);
+                pending.push_back({next, returned ? UNKNOWN : I});
+            }
+        }
+        return map;
+    }
+}
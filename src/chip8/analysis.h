@@ -0,0 +1,71 @@
+#ifndef CHIP8_ANALYSIS_H
+#define CHIP8_ANALYSIS_H
+
+#include <array>
+#include <map>
+#include <set>
+#include <vector>
+#include <cstdint>
+#include "state.h"
+#include "instruction.h"
+
+namespace CHIP8 {
+
+    /* A run of instructions that is only entered at its start and left at its end */
+    struct BasicBlock {
+        uint16_t start;   // Address of first instruction
+        uint16_t end;     // Address after the last instruction
+        std::vector<uint16_t> successors; // Addresses execution may continue at
+        bool dynamic;     // Ends in a jump only known at run time (Bnnn)
+    };
+
+    /* Code reachable from the entry point of a program */
+    struct CodeMap {
+        std::map<uint16_t, BasicBlock> blocks;   // Indexed by start address
+        std::array<bool, RAM_SIZE> instructions; // True where a reachable instruction starts
+    };
+
+    /* A subroutine, or the program from its entry point */
+    struct Routine {
+        std::vector<uint16_t> blocks; // Start of each block reached from its entry before returning
+        std::set<uint16_t> callees;   // Entry points of the subroutines it calls
+    };
+
+    /* What static analysis finds out about a program beyond its code, for tools such as the disassembler */
+    struct ProgramMap {
+        CodeMap code;
+        std::map<uint16_t, Routine> routines;  // Call graph, indexed by entry point
+        std::array<bool, RAM_SIZE> sprites;    // True for bytes drawn by Dxyn while I holds an Annn address
+        std::set<uint16_t> indirect_jumps;     // Addresses of Bnnn, whose target is only known at run time
+        std::set<uint16_t> self_modifying;     // Addresses of Fx33 and Fx55 storing over reachable code
+    };
+
+    /* Returns true if `op` ends a basic block */
+    bool ends_block(Op op);
+
+    /*
+    Discovers the code reachable from `entry` by following jumps, calls,
+    returns and skips, stopping at 00FD (exit). Only instructions in [entry, limit) are considered,
+    which is normally the region where the program was loaded.
+    */
+    CodeMap analyse_code(
+        const std::array<byte_t, RAM_SIZE>& ram,
+        uint16_t entry = RAM_PROG_OFFSET,
+        uint16_t limit = RAM_SIZE
+    );
+
+    /*
+    Analyses code as `analyse_code` does, groups its blocks into routines
+    and follows I from Annn to the sprites Dxyn draws and the bytes Fx33 and Fx55 store.
+    I is lost after instructions that change it by a register or a quirk, and after calls.
+    */
+    ProgramMap analyse_program(
+        const std::array<byte_t, RAM_SIZE>& ram,
+        uint16_t entry = RAM_PROG_OFFSET,
+        uint16_t limit = RAM_SIZE
+    );
+
+}
+
+
+#endif /* CHIP8_ANALYSIS_H */
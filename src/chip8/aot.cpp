@@ -0,0 +1,251 @@
+#include "aot.h"
+#include "analysis.h"
+#include "compiled.h"
+#include "instruction.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    namespace {
+
+        std::string hex(unsigned value, int digits){
+            char buffer[8];
+            std::snprintf(buffer, sizeof(buffer), "0x%0*X", digits, value);
+            return buffer;
+        }
+
+        std::string reg(byte_t x){
+            return "s.regs[" + hex(x, 1) + "]";
+        }
+
+        /* Returns the C++ expression naming `profile` */
+        const char* profile_enumerator(Profile profile){
+            switch(profile){
+                case Profile::COSMAC_VIP: return "CHIP8::Profile::COSMAC_VIP";
+                case Profile::CHIP48:     return "CHIP8::Profile::CHIP48";
+                case Profile::SCHIP:      return "CHIP8::Profile::SCHIP";
+                case Profile::XO_CHIP:    return "CHIP8::Profile::XO_CHIP";
+                case Profile::DEFAULT:    break;
+            }
+            return "CHIP8::Profile::DEFAULT";
+        }
+
+        /* A function emitted for a range of instructions */
+        struct Chunk {
+            uint16_t start;
+            uint16_t end;
+            uint16_t length;
+        };
+
+        /* Returns true if `op` writes RAM or may stay on itself (input, exit), which ends a chunk */
+        bool ends_chunk(Op op){
+            return op == Op::LD_BCD || op == Op::LD_STORE || op == Op::LD_KEY || op == Op::EXIT;
+        }
+
+        /*
+        Writes the statements of the instruction at `addr`, mirroring the interpreter.
+        Returns true if the statements already set the program counter.
+        */
+        bool emit_instruction(std::ostream& out, const Instruction& ins, uint16_t addr, const Quirks& quirks){
+            const std::string x = reg(ins.x);
+            const std::string y = reg(ins.y);
+            const std::string shifted = quirks.shift_uses_vy ? y : x;
+            const std::string reset_vf = quirks.logic_resets_vf ? "        " + reg(0xF) + " = 0;\n" : "";
+            const std::string next = hex(addr + 2, 4);
+            const std::string skip = hex(addr + 4, 4);
+            const std::string vf = reg(0xF);
+
+            out << "        // " << hex(addr, 4) << ": " << hex(ins.code, 4).substr(2) << "\n";
+            switch(ins.op){
+                case Op::UNDECODED:
+                case Op::UNKNOWN:
+                case Op::SYS:
+                case Op::COUNT:
+                    return false;
+                case Op::CLS:
+                    out << "        vm.get_framebuffer().clear();\n";
+                    return false;
+                case Op::JP:
+                    out << "        s.pc = " << hex(ins.nnn, 4) << ";\n";
+                    return true;
+                case Op::SE_BYTE:
+                case Op::SNE_BYTE:
+                case Op::SE_REG:
+                case Op::SNE_REG: {
+                    // Skipping past the end of RAM throws, and XO-CHIP skips
+                    // depend on the next instruction: leave them to the interpreter
+                    if(addr + 4 >= RAM_SIZE || quirks.xo_chip){
+                        break;
+                    }
+                    const std::string lhs = x;
+                    const std::string rhs = (ins.op == Op::SE_REG || ins.op == Op::SNE_REG) ? y : hex(ins.kk, 2);
+                    const char* cmp = (ins.op == Op::SE_BYTE || ins.op == Op::SE_REG) ? " == " : " != ";
+                    out << "        s.pc = (" << lhs << cmp << rhs << ") ? " << skip << " : " << next << ";\n";
+                    return true;
+                }
+                case Op::LD_BYTE:  out << "        " << x << " = " << hex(ins.kk, 2) << ";\n";  return false;
+                case Op::ADD_BYTE: out << "        " << x << " += " << hex(ins.kk, 2) << ";\n"; return false;
+                case Op::LD_REG:   out << "        " << x << " = " << y << ";\n";  return false;
+                case Op::OR:       out << "        " << x << " |= " << y << ";\n" << reset_vf; return false;
+                case Op::AND:      out << "        " << x << " &= " << y << ";\n" << reset_vf; return false;
+                case Op::XOR:      out << "        " << x << " ^= " << y << ";\n" << reset_vf; return false;
+                case Op::ADD_REG:
+                    out << "        " << vf << " = ((" << x << " + " << y << ") > 0xFF);\n";
+                    out << "        " << x << " += " << y << ";\n";
+                    return false;
+                case Op::SUB:
+                    out << "        " << vf << " = (" << x << " > " << y << ");\n";
+                    out << "        " << x << " -= " << y << ";\n";
+                    return false;
+                case Op::SHR:
+                    out << "        " << vf << " = (" << shifted << " & 0x1);\n";
+                    out << "        " << x << " = " << shifted << " >> 1;\n";
+                    return false;
+                case Op::SUBN:
+                    out << "        " << vf << " = (" << y << " > " << x << ");\n";
+                    out << "        " << x << " = " << y << " - " << x << ";\n";
+                    return false;
+                case Op::SHL:
+                    out << "        " << vf << " = (" << shifted << " & 0x80) >> 7;\n";
+                    out << "        " << x << " = " << shifted << " << 1;\n";
+                    return false;
+                case Op::LD_I:     out << "        s.Ireg = " << hex(ins.nnn, 4) << ";\n"; return false;
+                case Op::LD_VX_DT: out << "        " << x << " = s.DTreg;\n";  return false;
+                case Op::LD_DT:    out << "        s.DTreg = " << x << ";\n";  return false;
+                case Op::LD_ST:    out << "        s.STreg = " << x << ";\n";  return false;
+                case Op::ADD_I:    out << "        s.Ireg += " << x << ";\n";  return false;
+                case Op::LD_FONT:  out << "        s.Ireg = " << x << " * 5;\n"; return false;
+                case Op::LD_LOAD:
+                    // Reads past the end of RAM fault, or reach XO-CHIP memory, in the interpreter
+                    out << "        if(s.Ireg + " << hex(ins.x + 1, 2) << " > " << hex(RAM_SIZE, 4) << "){\n";
+                    out << "            s.pc = " << next << ";\n";
+                    out << "            vm.run_instruction(" << hex(ins.code, 4) << ");\n";
+                    out << "            if(vm.get_fault()) return;\n";
+                    out << "        } else {\n";
+                    out << "            for(uint16_t i = 0x0; i <= " << hex(ins.x, 1) << "; ++i){\n";
+                    out << "                s.regs[i] = s.ram[s.Ireg + i];\n";
+                    out << "            }\n";
+                    if(quirks.memory_increment == MemoryIncrement::X){
+                        out << "            s.Ireg += " << hex(ins.x, 1) << ";\n";
+                    } else if(quirks.memory_increment == MemoryIncrement::X_PLUS_ONE){
+                        out << "            s.Ireg += " << hex(ins.x + 1, 1) << ";\n";
+                    }
+                    out << "        }\n";
+                    return false;
+                default:
+                    break;
+            }
+
+            // Calls, returns, computed jumps, drawing, input, random numbers and
+            // RAM writes run through the interpreter after the program counter.
+            out << "        s.pc = " << next << ";\n";
+            out << "        vm.run_instruction(" << hex(ins.code, 4) << ");\n";
+            const bool ends = ends_block(ins.op) || ends_chunk(ins.op);
+            if(!ends && ins.op == Op::DRW){
+                // The only one that can fault without ending the chunk: stop on it
+                out << "        if(vm.get_fault()) return;\n";
+            }
+            return ends;
+        }
+    }
+
+    void generate_cpp(const std::vector<byte_t>& rom, const std::string& symbol, std::ostream& out, Profile profile){
+        if(rom.empty() || rom.size() > RAM_SIZE - RAM_PROG_OFFSET){
+            throw std::runtime_error("ROM is empty or too large");
+        }
+
+        std::array<byte_t, RAM_SIZE> ram{};
+        std::copy(rom.begin(), rom.end(), ram.begin() + RAM_PROG_OFFSET);
+
+        // The last instruction in RAM cannot be fetched by the interpreter
+        const uint16_t limit = std::min<uint32_t>(RAM_PROG_OFFSET + rom.size(), RAM_SIZE - 1);
+        const CodeMap map = analyse_code(ram, RAM_PROG_OFFSET, limit);
+
+        // Split blocks into chunks of bounded length that end after RAM writes,
+        // so the interpreter takes over before overwritten code would run.
+        std::vector<Chunk> chunks;
+        for(const auto& [start, block] : map.blocks){
+            Chunk chunk{start, start, 0};
+            for(uint16_t addr = start; addr < block.end; addr += 2){
+                const Instruction ins = decode((ram[addr] << 8) | ram[addr + 1]);
+                chunk.end = addr + 2;
+                chunk.length++;
+                if(chunk.length == COMPILED_BLOCK_MAX_LENGTH || ends_chunk(ins.op)){
+                    chunks.push_back(chunk);
+                    chunk = Chunk{chunk.end, chunk.end, 0};
+                }
+            }
+            if(chunk.length != 0){
+                chunks.push_back(chunk);
+            }
+        }
+
+        out << "// Generated by chip8_aot, do not edit.\n";
+        out << "#include \"chip8/chip8.h\"\n";
+        out << "#include \"chip8/compiled.h\"\n\n";
+        out << "namespace {\n\n";
+
+        out << "    const CHIP8::byte_t ROM[] = {";
+        for(std::size_t i = 0; i != rom.size(); ++i){
+            out << ((i % 16 == 0) ? "\n        " : " ") << hex(rom[i], 2) << ",";
+        }
+        out << "\n    };\n\n";
+
+        for(const Chunk& chunk : chunks){
+            out << "    void block_" << hex(chunk.start, 4).substr(2) << "(CHIP8::Interpreter& vm){\n";
+            out << "        CHIP8::State& s = vm.get_state();\n";
+            bool jumped = false;
+            for(uint16_t addr = chunk.start; addr < chunk.end; addr += 2){
+                const Instruction ins = decode((ram[addr] << 8) | ram[addr + 1]);
+                jumped = emit_instruction(out, ins, addr, get_quirks(profile));
+            }
+            if(!jumped){
+                out << "        s.pc = " << hex(chunk.end, 4) << ";\n";
+            }
+            out << "    }\n\n";
+        }
+
+        out << "    const CHIP8::CompiledBlock BLOCKS[] = {\n";
+        for(const Chunk& chunk : chunks){
+            out << "        {" << hex(chunk.start, 4) << ", " << hex(chunk.end, 4) << ", "
+                << chunk.length << ", block_" << hex(chunk.start, 4).substr(2) << "},\n";
+        }
+        out << "    };\n\n";
+        out << "}\n\n";
+
+        out << "extern const CHIP8::CompiledProgram " << symbol << ";\n";
+        out << "const CHIP8::CompiledProgram " << symbol << " = {\n";
+        out << "    ROM, sizeof(ROM), BLOCKS, sizeof(BLOCKS) / sizeof(BLOCKS[0]), " << profile_enumerator(profile) << "\n";
+        out << "};\n\n";
+
+        out << "#ifndef CHIP8_AOT_NO_MAIN\n";
+        out << "#if defined(CHIP8_WITH_SFML)\n";
+        out << "#include \"chip8/sfml_renderer.h\"\n";
+        out << "#endif\n\n";
+        out << "int main(int argc, const char* argv[]){\n";
+        out << "#if defined(CHIP8_WITH_SFML)\n";
+        out << "    // chip8_game [clock speed in Hz, 0 for unthrottled]\n";
+        out << "    CHIP8::Interpreter vm(std::make_unique<CHIP8::SFMLRenderer>());\n";
+        out << "    vm.load_compiled(" << symbol << ");\n";
+        out << "    vm.set_engine(CHIP8::Engine::AOT);\n";
+        out << "    if(argc == 2){\n";
+        out << "        vm.set_clock_speed(std::stod(argv[1]));\n";
+        out << "    }\n";
+        out << "    vm.run();\n";
+        out << "#else\n";
+        out << "    // chip8_game [instructions], runs headless and reports the instruction rate\n";
+        out << "    CHIP8::Interpreter vm;\n";
+        out << "    vm.load_compiled(" << symbol << ");\n";
+        out << "    vm.set_engine(CHIP8::Engine::AOT);\n";
+        out << "    const uint64_t count = (argc == 2) ? std::stoull(argv[1]) : 100000000;\n";
+        out << "    const auto begin = std::chrono::steady_clock::now();\n";
+        out << "    vm.run_instructions(count);\n";
+        out << "    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;\n";
+        out << "    std::cout << \"Instruction rate: \" << count / elapsed.count() << \" Hz\" << std::endl;\n";
+        out << "#endif\n";
+        out << "}\n";
+        out << "#endif\n";
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef CHIP8_AOT_H
+#define CHIP8_AOT_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "state.h"
+#include "quirks.h"
+
+namespace CHIP8 {
+
+    /*
+    Translates a ROM into C++ source that defines a `CompiledProgram` named `symbol`,
+    following the quirks of `profile`.
+    Reachable code is split into blocks, each translated into a function that
+    operates on the interpreter state. Instructions that need the display, keypad,
+    stack or random numbers, or that write RAM, are run through the interpreter.
+    Unless CHIP8_AOT_NO_MAIN is defined, the source also has a `main` that runs the game.
+    */
+    void generate_cpp(
+        const std::vector<byte_t>& rom, const std::string& symbol, std::ostream& out,
+        Profile profile = Profile::DEFAULT
+    );
+
+}
+
+
+#endif /* CHIP8_AOT_H */
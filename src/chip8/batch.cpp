@@ -0,0 +1,435 @@
+#include "batch.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    struct Batch::AllLanes {
+        lane_t count;
+
+        template<class F>
+        void each(F f) const {
+            for(lane_t lane = 0; lane != count; ++lane){
+                f(lane);
+            }
+        }
+    };
+
+    struct Batch::LaneList {
+        const uint32_t* lanes;
+        lane_t count;
+
+        template<class F>
+        void each(F f) const {
+            for(lane_t i = 0; i != count; ++i){
+                f(lane_t(lanes[i]));
+            }
+        }
+    };
+
+    Batch::Batch(const std::vector<byte_t>& program, const std::vector<BatchInstance>& instances, Profile profile)
+        : m_size(instances.size()), m_quirks(get_quirks(profile)), m_frame(0), m_faulted(0) {
+        if(program.size() > RAM_SIZE - RAM_PROG_OFFSET){
+            throw std::runtime_error("Program is too large");
+        }
+        if(m_quirks.xo_chip){
+            throw std::runtime_error("Batches do not support XO-CHIP");
+        }
+
+        State initial;
+        initial.reset();
+        std::copy(program.begin(), program.end(), initial.ram.begin() + RAM_PROG_OFFSET);
+
+        m_regs.assign(REGISTER_NUM * m_size, 0);
+        m_rpl.assign(RPL_FLAG_NUM * m_size, 0);
+        m_stack.assign(STACK_SIZE * m_size, 0);
+        m_pc.assign(m_size, RAM_PROG_OFFSET);
+        m_Ireg.assign(m_size, 0);
+        m_DTreg.assign(m_size, 0);
+        m_STreg.assign(m_size, 0);
+        m_sp.assign(m_size, 0);
+        m_keys.assign(m_size, 0);
+        m_ram.resize(RAM_SIZE * m_size);
+        m_ram_diverged.assign(RAM_SIZE, false);
+        m_framebuffers.resize(m_size);
+        m_rng.resize(m_size);
+        m_traces.resize(m_size);
+        m_faults.assign(m_size, nullptr);
+
+        for(lane_t lane = 0; lane != m_size; ++lane){
+            std::copy(initial.ram.begin(), initial.ram.end(), ram(lane));
+            m_rng[lane].seed(instances[lane].seed);
+            m_traces[lane] = instances[lane].keys;
+        }
+    }
+
+    void Batch::run_frames(uint64_t frames, uint64_t instructions_per_frame){
+        for(uint64_t frame = 0; frame != frames; ++frame){
+            for(lane_t lane = 0; lane != m_size; ++lane){
+                const KeyTrace& trace = m_traces[lane];
+                m_keys[lane] = (m_frame < trace.size()) ? trace[m_frame] : 0;
+            }
+
+            for(uint64_t i = 0; i != instructions_per_frame; ++i){
+                step();
+            }
+
+            for(lane_t lane = 0; lane != m_size; ++lane){
+                if(m_faults[lane] == nullptr){
+                    m_DTreg[lane] -= (m_DTreg[lane] != 0);
+                    m_STreg[lane] -= (m_STreg[lane] != 0);
+                }
+            }
+            m_frame++;
+        }
+    }
+
+    void Batch::step(){
+        if(m_size == 0 || m_faulted == m_size){
+            return;
+        }
+
+        // Fast path: every instance is at the same instruction of the shared program
+        if(m_faulted == 0){
+            const uint16_t pc = m_pc[0];
+            uint16_t differ = 0;
+            for(lane_t lane = 0; lane != m_size; ++lane){
+                differ |= m_pc[lane] ^ pc;
+            }
+            if(differ == 0 && pc + 2 < RAM_SIZE && !m_ram_diverged[pc] && !m_ram_diverged[pc + 1]){
+                const Instruction ins = decode((ram(0)[pc] << 8) | ram(0)[pc + 1]);
+                for(lane_t lane = 0; lane != m_size; ++lane){
+                    m_pc[lane] = pc + 2;
+                }
+                execute(ins, AllLanes{m_size});
+                return;
+            }
+        }
+
+        // Regroup instances by the opcode they fetch
+        m_fetched.clear();
+        for(lane_t lane = 0; lane != m_size; ++lane){
+            if(m_faults[lane] != nullptr){
+                continue;
+            }
+            const uint16_t pc = m_pc[lane];
+            m_pc[lane] = pc + 2;
+            if(pc + 2 >= RAM_SIZE){
+                fault(lane, Trap::PC_OUT_OF_RANGE);
+                continue;
+            }
+            m_fetched.emplace_back((ram(lane)[pc] << 8) | ram(lane)[pc + 1], uint32_t(lane));
+        }
+        std::sort(m_fetched.begin(), m_fetched.end());
+
+        for(std::size_t first = 0; first != m_fetched.size(); ){
+            const uint16_t code = m_fetched[first].first;
+            m_group.clear();
+            std::size_t last = first;
+            for(; last != m_fetched.size() && m_fetched[last].first == code; ++last){
+                m_group.push_back(m_fetched[last].second);
+            }
+            execute(decode(code), LaneList{m_group.data(), m_group.size()});
+            first = last;
+        }
+    }
+
+    State Batch::get_state(lane_t lane) const {
+        State state;
+        for(byte_t i = 0; i != REGISTER_NUM; ++i){
+            state.regs[i] = m_regs[i * m_size + lane];
+        }
+        for(byte_t i = 0; i != RPL_FLAG_NUM; ++i){
+            state.rpl[i] = m_rpl[i * m_size + lane];
+        }
+        for(byte_t i = 0; i != STACK_SIZE; ++i){
+            state.stack[i] = m_stack[i * m_size + lane];
+        }
+        state.pc    = m_pc[lane];
+        state.Ireg  = m_Ireg[lane];
+        state.DTreg = m_DTreg[lane];
+        state.STreg = m_STreg[lane];
+        state.sp    = m_sp[lane];
+        std::copy_n(m_ram.begin() + lane * RAM_SIZE, RAM_SIZE, state.ram.begin());
+        return state;
+    }
+
+    void Batch::fault(lane_t lane, Trap trap){
+        if(m_faults[lane] == nullptr){
+            m_faults[lane] = trap_name(trap);
+            m_faulted++;
+            // Faults come before an instruction moves the program counter, so it is only past the fetch
+            m_pc[lane] -= 2;
+        }
+    }
+
+    template<class Lanes>
+    void Batch::execute(const Instruction& ins, const Lanes& lanes){
+        byte_t* const vx = reg(ins.x);
+        byte_t* const vy = reg(ins.y);
+        byte_t* const vf = reg(0xF);
+        uint16_t* const pc = m_pc.data();
+        uint16_t* const I  = m_Ireg.data();
+        const byte_t   kk  = ins.kk;
+        const uint16_t nnn = ins.nnn;
+        const byte_t*  shifted = m_quirks.shift_uses_vy ? vy : vx;
+        const bool     reset_vf = m_quirks.logic_resets_vf;
+        const bool     super_chip = m_quirks.super_chip;
+
+        // Skipping past the end of RAM faults, like State::advance
+        auto skip_if = [&](auto condition){
+            lanes.each([&](lane_t l){
+                if(condition(l)){
+                    if(pc[l] + 2 >= RAM_SIZE){
+                        fault(l, Trap::PC_OUT_OF_RANGE);
+                    } else {
+                        pc[l] += 2;
+                    }
+                }
+            });
+        };
+
+        // FX55 and FX65 leave I according to the quirks
+        auto increment_i = [&](lane_t l){
+            if(m_quirks.memory_increment == MemoryIncrement::X){
+                I[l] += ins.x;
+            } else if(m_quirks.memory_increment == MemoryIncrement::X_PLUS_ONE){
+                I[l] += ins.x + 1;
+            }
+        };
+
+        // Out of range RAM accesses fault, like in the interpreter
+        auto in_ram = [&](lane_t l, uint32_t size){
+            if(uint32_t(I[l]) + size > RAM_SIZE){
+                fault(l, Trap::MEMORY_OUT_OF_RANGE);
+                return false;
+            }
+            return true;
+        };
+
+        switch(ins.op){
+            case Op::UNDECODED:
+            case Op::UNKNOWN:
+            case Op::SYS:
+            case Op::COUNT:
+            case Op::LD_I_LONG: // XO-CHIP only, which batches reject
+            case Op::PLANE:
+            case Op::AUDIO:
+            case Op::PITCH:
+                break;
+            case Op::CLS:
+                lanes.each([&](lane_t l){ m_framebuffers[l].clear(); });
+                break;
+            case Op::RET:
+                lanes.each([&](lane_t l){
+                    if(m_sp[l] == 0){
+                        fault(l, Trap::STACK_UNDERFLOW);
+                        return;
+                    }
+                    m_sp[l]--;
+                    pc[l] = m_stack[m_sp[l] * m_size + l];
+                });
+                break;
+            case Op::JP:
+                lanes.each([&](lane_t l){ pc[l] = nnn; });
+                break;
+            case Op::CALL:
+                lanes.each([&](lane_t l){
+                    if(m_sp[l] + 1 == STACK_SIZE){
+                        fault(l, Trap::STACK_OVERFLOW);
+                        return;
+                    }
+                    m_stack[m_sp[l] * m_size + l] = pc[l];
+                    m_sp[l]++;
+                    pc[l] = nnn;
+                });
+                break;
+            case Op::SE_BYTE:  skip_if([&](lane_t l){ return vx[l] == kk; });    break;
+            case Op::SNE_BYTE: skip_if([&](lane_t l){ return vx[l] != kk; });    break;
+            case Op::SE_REG:
+            case Op::SAVE_RANGE: // 5xy0 without XO-CHIP
+            case Op::LOAD_RANGE:
+                skip_if([&](lane_t l){ return vy[l] == vx[l]; });
+                break;
+            case Op::SNE_REG:  skip_if([&](lane_t l){ return vy[l] != vx[l]; }); break;
+            case Op::LD_BYTE:  lanes.each([&](lane_t l){ vx[l] = kk; });  break;
+            case Op::ADD_BYTE: lanes.each([&](lane_t l){ vx[l] += kk; }); break;
+            case Op::LD_REG:   lanes.each([&](lane_t l){ vx[l] = vy[l]; });  break;
+            case Op::OR:
+                lanes.each([&](lane_t l){ vx[l] |= vy[l]; if(reset_vf) vf[l] = 0; });
+                break;
+            case Op::AND:
+                lanes.each([&](lane_t l){ vx[l] &= vy[l]; if(reset_vf) vf[l] = 0; });
+                break;
+            case Op::XOR:
+                lanes.each([&](lane_t l){ vx[l] ^= vy[l]; if(reset_vf) vf[l] = 0; });
+                break;
+            case Op::ADD_REG:
+                lanes.each([&](lane_t l){
+                    vf[l] = ((vx[l] + vy[l]) > 0xFF);
+                    vx[l] += vy[l];
+                });
+                break;
+            case Op::SUB:
+                lanes.each([&](lane_t l){
+                    vf[l] = (vx[l] > vy[l]);
+                    vx[l] -= vy[l];
+                });
+                break;
+            case Op::SHR:
+                lanes.each([&](lane_t l){
+                    vf[l] = (shifted[l] & 0x1);
+                    vx[l] = shifted[l] >> 1;
+                });
+                break;
+            case Op::SUBN:
+                lanes.each([&](lane_t l){
+                    vf[l] = (vy[l] > vx[l]);
+                    vx[l] = vy[l] - vx[l];
+                });
+                break;
+            case Op::SHL:
+                lanes.each([&](lane_t l){
+                    vf[l] = (shifted[l] & 0x80) >> 7;
+                    vx[l] = shifted[l] << 1;
+                });
+                break;
+            case Op::LD_I:
+                lanes.each([&](lane_t l){ I[l] = nnn; });
+                break;
+            case Op::JP_V0: {
+                const byte_t* offset = m_quirks.jump_uses_vx ? vx : reg(0x0);
+                lanes.each([&](lane_t l){
+                    const uint16_t target = nnn + offset[l];
+                    if(target >= RAM_SIZE){
+                        fault(l, Trap::PC_OUT_OF_RANGE);
+                    } else {
+                        pc[l] = target;
+                    }
+                });
+                break;
+            }
+            case Op::RND:
+                lanes.each([&](lane_t l){ vx[l] = m_rng[l].next_byte() & kk; });
+                break;
+            case Op::DRW:
+                lanes.each([&](lane_t l){
+                    // Dxy0 is 16x16 in high resolution and 8x16 in low resolution, as in the interpreter
+                    if(super_chip && ins.n == 0 && m_framebuffers[l].is_hires()){
+                        if(I[l] + 32 > RAM_SIZE){
+                            fault(l, Trap::MEMORY_OUT_OF_RANGE);
+                            return;
+                        }
+                        vf[l] = m_framebuffers[l].draw_sprite_16(vx[l], vy[l], ram(l) + I[l]);
+                        return;
+                    }
+                    const byte_t height = (super_chip && ins.n == 0) ? 16 : ins.n;
+                    if(I[l] + height > RAM_SIZE){
+                        fault(l, Trap::MEMORY_OUT_OF_RANGE);
+                        return;
+                    }
+                    vf[l] = m_framebuffers[l].draw_sprite(vx[l], vy[l], ram(l) + I[l], height);
+                });
+                break;
+            case Op::SKP:  skip_if([&](lane_t l){ return  ((m_keys[l] >> (vx[l] & 0xF)) & 0x1); }); break;
+            case Op::SKNP: skip_if([&](lane_t l){ return !((m_keys[l] >> (vx[l] & 0xF)) & 0x1); }); break;
+            case Op::LD_VX_DT:
+                lanes.each([&](lane_t l){ vx[l] = m_DTreg[l]; });
+                break;
+            case Op::LD_KEY:
+                lanes.each([&](lane_t l){
+                    for(uint16_t key = 0x0; key != 0x10; ++key){
+                        if((m_keys[l] >> key) & 0x1){
+                            vx[l] = byte_t(key);
+                            return;
+                        }
+                    }
+                    pc[l] -= 2; // Prevents program counter from advancing
+                });
+                break;
+            case Op::LD_DT:
+                lanes.each([&](lane_t l){ m_DTreg[l] = vx[l]; });
+                break;
+            case Op::LD_ST:
+                lanes.each([&](lane_t l){ m_STreg[l] = vx[l]; });
+                break;
+            case Op::ADD_I:
+                lanes.each([&](lane_t l){ I[l] += vx[l]; });
+                break;
+            case Op::LD_FONT:
+                lanes.each([&](lane_t l){ I[l] = vx[l] * 5; });
+                break;
+            case Op::LD_BCD:
+                lanes.each([&](lane_t l){
+                    if(!in_ram(l, 3)){
+                        return;
+                    }
+                    byte_t* mem = ram(l) + I[l];
+                    mem[2] =  vx[l]      % 10;
+                    mem[1] = (vx[l]/10)  % 10;
+                    mem[0] = (vx[l]/100) % 10;
+                    m_ram_diverged[I[l]] = m_ram_diverged[I[l] + 1] = m_ram_diverged[I[l] + 2] = true;
+                });
+                break;
+            case Op::LD_STORE:
+                lanes.each([&](lane_t l){
+                    if(!in_ram(l, ins.x + 1)){
+                        return;
+                    }
+                    for(uint16_t i = 0x0; i <= ins.x; ++i){
+                        ram(l)[I[l] + i] = m_regs[i * m_size + l];
+                        m_ram_diverged[I[l] + i] = true;
+                    }
+                    increment_i(l);
+                });
+                break;
+            case Op::LD_LOAD:
+                lanes.each([&](lane_t l){
+                    if(!in_ram(l, ins.x + 1)){
+                        return;
+                    }
+                    for(uint16_t i = 0x0; i <= ins.x; ++i){
+                        m_regs[i * m_size + l] = ram(l)[I[l] + i];
+                    }
+                    increment_i(l);
+                });
+                break;
+            // SUPER-CHIP, ignored like other machine code routines and unknown opcodes without it
+            case Op::SCD:
+                if(super_chip) lanes.each([&](lane_t l){ m_framebuffers[l].scroll_down(ins.n); });
+                break;
+            case Op::SCR:
+                if(super_chip) lanes.each([&](lane_t l){ m_framebuffers[l].scroll_right(); });
+                break;
+            case Op::SCL:
+                if(super_chip) lanes.each([&](lane_t l){ m_framebuffers[l].scroll_left(); });
+                break;
+            case Op::EXIT:
+                if(super_chip) lanes.each([&](lane_t l){ pc[l] -= 2; });
+                break;
+            case Op::LOW:
+                if(super_chip) lanes.each([&](lane_t l){ m_framebuffers[l].set_hires(false); });
+                break;
+            case Op::HIGH:
+                if(super_chip) lanes.each([&](lane_t l){ m_framebuffers[l].set_hires(true); });
+                break;
+            case Op::LD_HF:
+                if(super_chip) lanes.each([&](lane_t l){ I[l] = BIG_HEX_ALPHABET_OFFSET + vx[l] * BIG_HEX_DIGIT_SIZE; });
+                break;
+            case Op::LD_R:
+                if(super_chip) lanes.each([&](lane_t l){
+                    for(uint16_t i = 0x0; i <= ins.x; ++i){
+                        m_rpl[i * m_size + l] = m_regs[i * m_size + l];
+                    }
+                });
+                break;
+            case Op::LD_VX_R:
+                if(super_chip) lanes.each([&](lane_t l){
+                    for(uint16_t i = 0x0; i <= ins.x; ++i){
+                        m_regs[i * m_size + l] = m_rpl[i * m_size + l];
+                    }
+                });
+                break;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef CHIP8_BATCH_H
+#define CHIP8_BATCH_H
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "state.h"
+#include "framebuffer.h"
+#include "instruction.h"
+#include "quirks.h"
+#include "random.h"
+#include "fault.h"
+
+namespace CHIP8 {
+
+    /* Keypad at each frame, bit k set while key k is held. No keys are held past the end. */
+    typedef std::vector<uint16_t> KeyTrace;
+
+    /* Settings of one virtual machine in a batch */
+    struct BatchInstance {
+        uint32_t seed;
+        KeyTrace keys;
+    };
+
+    /*
+    Runs many virtual machines with the same program in lockstep.
+    Registers, timers, program counters and stacks are stored as structures of arrays
+    (e.g. `regs[16][N]`), so an instruction that all instances are at is decoded once
+    and executed for every instance by loops the compiler turns into SIMD code.
+    Instances at different instructions are regrouped by opcode at every step,
+    and each group runs over a list of its instances.
+    Each instance executes exactly the instructions an `Interpreter` would, and an
+    instance that faults (e.g. stack overflow) stops while the others carry on.
+    */
+    class Batch {
+
+    public:
+        typedef std::size_t lane_t;
+
+        /* Loads `program` into one instance per element of `instances`.
+        Throws for the XO-CHIP profile, whose memory and planes batches do not hold. */
+        Batch(
+            const std::vector<byte_t>& program,
+            const std::vector<BatchInstance>& instances,
+            Profile profile = Profile::DEFAULT
+        );
+
+        /* Number of instances */
+        lane_t size() const { return m_size; }
+
+        /* Runs `frames` frames of `instructions_per_frame` instructions on every instance.
+        Keys are read from the traces at the start of each frame and timers tick at its end. */
+        void run_frames(uint64_t frames, uint64_t instructions_per_frame);
+
+        /* Executes one instruction on every instance that has not faulted */
+        void step();
+
+        /* Returns the state of an instance */
+        State get_state(lane_t lane) const;
+
+        /* Returns the display of an instance */
+        const Framebuffer& get_framebuffer(lane_t lane) const { return m_framebuffers[lane]; }
+
+        /* Returns the description of the trap that stopped an instance, or nullptr if it is still running */
+        const char* get_fault(lane_t lane) const { return m_faults[lane]; }
+
+        /* Returns the number of frames run so far */
+        uint64_t get_frame() const { return m_frame; }
+
+    private:
+        /* Instances a step executes: all of them, or a list */
+        struct AllLanes;
+        struct LaneList;
+
+        lane_t m_size;
+        Quirks m_quirks;
+        uint64_t m_frame;
+
+        // Structure of arrays, element [i][lane] stored at [i * m_size + lane]
+        std::vector<byte_t>   m_regs;
+        std::vector<byte_t>   m_rpl; // SUPER-CHIP user flags
+        std::vector<uint16_t> m_stack;
+        std::vector<uint16_t> m_pc;
+        std::vector<uint16_t> m_Ireg;
+        std::vector<byte_t>   m_DTreg;
+        std::vector<byte_t>   m_STreg;
+        std::vector<byte_t>   m_sp;
+        std::vector<uint16_t> m_keys; // Keypad of the current frame
+
+        std::vector<byte_t>       m_ram; // RAM_SIZE bytes per instance
+        std::vector<bool>         m_ram_diverged; // Addresses some instance has written
+        std::vector<Framebuffer>  m_framebuffers;
+        std::vector<Random>       m_rng;
+        std::vector<KeyTrace>     m_traces;
+        std::vector<const char*>  m_faults;
+        lane_t m_faulted;
+
+        // Scratch for regrouping
+        std::vector<std::pair<uint16_t, uint32_t>> m_fetched; // Opcode and lane
+        std::vector<uint32_t> m_group;
+
+        byte_t* reg(byte_t x) { return m_regs.data() + x * m_size; }
+        byte_t* ram(lane_t lane) { return m_ram.data() + lane * RAM_SIZE; }
+
+        /* Stops an instance with a trap, putting its program counter back on the faulting instruction */
+        void fault(lane_t lane, Trap trap);
+
+        /* Executes `ins`, already fetched, on `lanes` */
+        template<class Lanes> void execute(const Instruction& ins, const Lanes& lanes);
+
+    };
+
+}
+
+
+#endif /* CHIP8_BATCH_H */
@@ -1,251 +1,437 @@
 #include "chip8.h"
+#include "headless_renderer.h"
+#include "mapped_file.h"
+#include "movie.h"
+#include <array>
+#include <chrono>
+#include <cstring>
 #include <sstream>
+#include <thread>
+#include <exception>
 
 namespace CHIP8 {
 
-    Interpreter::Interpreter(){
+    Interpreter::Interpreter()
+        : Interpreter(std::make_unique<HeadlessRenderer>()) { }
+
+    Interpreter::Interpreter(std::unique_ptr<Renderer> renderer)
+        : m_renderer(std::move(renderer)), m_recording(nullptr) {
+        if(!m_renderer){
+            throw std::runtime_error("Interpreter requires a renderer");
+        }
+        reset();
+        m_rng.seed(uint32_t(std::time(nullptr)));
+        m_timer_freq = 60.0; // Hz
+        m_clock_speed = DEFAULT_CLOCK_SPEED;
+        set_timing(Timing::UNIFORM);
+        m_instruction_rate = 0.0;
+        m_engine = Engine::SWITCH;
+        m_profile = Profile::DEFAULT;
+        set_profile(Profile::DEFAULT);
+    }
+
+    Interpreter::~Interpreter(){ }
+
+    void Interpreter::reset(){
         m_state.reset();
+        invalidate_decoded();
         // Set program counter to beginning of program
         m_state.pc = 0x200; // or 0x600 on ETI systems
-        m_rng.seed(std::time(nullptr));
+        m_framebuffer.clear();
+        m_framebuffer.mark_all_dirty();
         m_timer = 0.0;
-        m_timer_freq = 60.0; // Hz
+        m_pending_ticks = 0;
+        m_cycle_budget = 0.0;
+        m_keys = 0;
+        clear_fault();
+        if(m_xo){
+            m_xo->reset();
+        }
     }
 
     void Interpreter::load_file(std::string filename){
-        std::ifstream input(filename, std::ios::binary);
-        if(!input){
-            throw std::runtime_error("Input file not found");
-        }
-        
-        // The contents are copied to the program region of the RAM
-        input.read(
-            reinterpret_cast<char*>(m_state.ram.data()) + RAM_PROG_OFFSET,
-            RAM_SIZE - RAM_PROG_OFFSET
-        );
+        const MappedFile file(filename);
+
+        // Bytes past the address space are left out
+        const std::size_t capacity = (m_xo ? XO_RAM_SIZE : RAM_SIZE) - RAM_PROG_OFFSET;
+        load_bytes(file.data(), std::min(file.size(), capacity));
+    }
 
-        input.close();
+    void Interpreter::load_bytes(const std::vector<byte_t>& program){
+        load_bytes(program.data(), program.size());
     }
 
-    void Interpreter::load_bytes(std::vector<byte_t> program){
-        if(program.size() > RAM_SIZE - RAM_PROG_OFFSET){
+    void Interpreter::load_bytes(const byte_t* program, std::size_t size){
+        const std::size_t capacity = (m_xo ? XO_RAM_SIZE : RAM_SIZE) - RAM_PROG_OFFSET;
+        if(size > capacity){
             throw std::runtime_error("Program is too large");
         }
-        std::copy_n(program.begin(), program.size(), m_state.ram.begin() + RAM_PROG_OFFSET);
+        const std::size_t low = std::min<std::size_t>(size, RAM_SIZE - RAM_PROG_OFFSET);
+        std::copy_n(program, low, m_state.ram.begin() + RAM_PROG_OFFSET);
+        if(m_xo){
+            std::copy(program + low, program + size, m_xo->high_ram.begin());
+        }
+        invalidate_decoded(RAM_PROG_OFFSET, low);
+    }
+
+    void Interpreter::load_predecode(const Predecode& predecode){
+        for(std::size_t i = RAM_PROG_OFFSET >> 1; i != m_decoded.size(); ++i){
+            const Instruction& ins = predecode.decoded[i];
+            const uint16_t code = (m_state.ram[2 * i] << 8) | m_state.ram[2 * i + 1];
+            if(ins.op != Op::UNDECODED && ins.op < Op::COUNT && ins.code == code){
+                m_decoded[i] = ins;
+            }
+        }
+    }
+
+    void Interpreter::load_compiled(const CompiledProgram& program){
+        set_profile(program.profile);
+        load_bytes(program.rom, program.rom_size);
+        m_compiled.assign(RAM_SIZE, nullptr);
+        m_compiled_coverage.assign(RAM_SIZE, 0);
+        for(uint16_t i = 0; i != program.block_count; ++i){
+            const CompiledBlock& block = program.blocks[i];
+            m_compiled[block.start] = &block;
+            for(uint16_t addr = block.start; addr != block.end; ++addr){
+                m_compiled_coverage[addr]++;
+            }
+        }
+    }
+
+    void Interpreter::save_state(Snapshot& snapshot) const {
+        if(m_xo){
+            throw std::runtime_error("Snapshots do not hold XO-CHIP memory");
+        }
+        // Cleared and filled member by member, so padding is zero on disk and in rewind deltas
+        std::memset(static_cast<void*>(&snapshot), 0, sizeof(Snapshot));
+        snapshot.header = SnapshotHeader::current();
+        snapshot.state.ram   = m_state.ram;
+        snapshot.state.stack = m_state.stack;
+        snapshot.state.regs  = m_state.regs;
+        snapshot.state.rpl   = m_state.rpl;
+        snapshot.state.DTreg = m_state.DTreg;
+        snapshot.state.STreg = m_state.STreg;
+        snapshot.state.Ireg  = m_state.Ireg;
+        snapshot.state.pc    = m_state.pc;
+        snapshot.state.sp    = m_state.sp;
+        apply_timer_ticks(snapshot.state, m_pending_ticks);
+        snapshot.framebuffer = m_framebuffer;
+        snapshot.rng = m_rng;
+        snapshot.timer = m_timer;
+        snapshot.cycle_budget = m_cycle_budget;
+    }
+
+    void Interpreter::load_state(const Snapshot& snapshot){
+        if(!snapshot.header.is_compatible()){
+            throw std::runtime_error("Snapshot was written by an incompatible version");
+        }
+
+        // Keep the code decoded from RAM the snapshot leaves unchanged
+        constexpr uint16_t CHUNK = 64;
+        for(uint16_t addr = 0; addr < RAM_SIZE; addr += CHUNK){
+            if(std::memcmp(&m_state.ram[addr], &snapshot.state.ram[addr], CHUNK) != 0){
+                invalidate_decoded(addr, CHUNK);
+            }
+        }
+
+        m_state = snapshot.state;
+        m_framebuffer = snapshot.framebuffer;
+        m_framebuffer.mark_all_dirty();
+        m_rng = snapshot.rng;
+        m_timer = snapshot.timer;
+        m_pending_ticks = 0;
+        m_cycle_budget = snapshot.cycle_budget;
+        clear_fault();
+    }
+
+    void Interpreter::save_state(const std::string& filename) const {
+        Snapshot snapshot;
+        save_state(snapshot);
+        write_snapshot(filename, snapshot);
+    }
+
+    void Interpreter::load_state(const std::string& filename){
+        const SnapshotFile file(filename);
+        load_state(file[0]);
     }
 
     void Interpreter::run(){
+        if(m_recording && m_clock_speed == CLOCK_UNTHROTTLED){
+            throw std::runtime_error("Recording needs a fixed clock speed to be reproducible");
+        }
+
         // Initialise window
-        double dt;
-        m_renderer.init();
+        m_renderer->init();
+
+        // Emulate on another thread and present on this one, which owns the window.
+        // Neither waits on the other: the newest complete frame is handed over.
+        TripleBuffer<Frame> frames;
+        std::atomic<bool> running(true);
+        std::exception_ptr error;
+        std::thread emulation([&](){
+            try {
+                emulate(frames, running);
+            } catch(...){
+                error = std::current_exception();
+            }
+            running = false;
+        });
+
+#if defined(CHIP8_PROFILE)
+        // The profiler belongs to the emulation thread, so time spent here is added once it is joined
+        std::array<double, std::size_t(Phase::COUNT)> presenting{};
+        auto mark = std::chrono::steady_clock::now();
+        auto attribute = [&](Phase phase){
+            const auto now = std::chrono::steady_clock::now();
+            presenting[std::size_t(phase)] += std::chrono::duration<double>(now - mark).count();
+            mark = now;
+        };
+        #define CHIP8_PROFILE_PHASE(phase) attribute(phase)
+#else
+        #define CHIP8_PROFILE_PHASE(phase)
+#endif
 
-        while(m_renderer.is_running()){
-            dt = m_renderer.update();
-            update_timers(dt);
+        uint64_t shown = 0;
+        while(m_renderer->is_running() && running){
+            const bool fresh = frames.take();
+            Frame& frame = frames.front();
+            if(fresh && frame.number != shown + 1){
+                // Rows changed in the frames skipped are missing from the dirty rows
+                frame.first.mark_all_dirty();
+                frame.second.mark_all_dirty();
+            }
+            shown = frame.number;
+
+            // Without a new frame, nothing is drawn but input is still handled
+            if(frame.two_planes){
+                m_renderer->update(frame.first, frame.second);
+            } else {
+                m_renderer->update(frame.first);
+            }
+            frame.first.clear_dirty();
+            frame.second.clear_dirty();
+            CHIP8_PROFILE_PHASE(Phase::PRESENT_INPUT);
+            if(!fresh){
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHIP8_PROFILE_PHASE(Phase::PRESENT_IDLE);
+        }
+        #undef CHIP8_PROFILE_PHASE
 
-            uint16_t code = m_state.advance();
-            run_instruction(code);
+        running = false;
+        emulation.join();
+#if defined(CHIP8_PROFILE)
+        if(m_profiler){
+            for(std::size_t i = 0; i != presenting.size(); ++i){
+                m_profiler->add_time(Phase(i), presenting[i]);
+            }
+        }
+#endif
+        if(error){
+            std::rethrow_exception(error);
         }
     }
 
+    void Interpreter::emulate(TripleBuffer<Frame>& frames, const std::atomic<bool>& running){
+        using clock = std::chrono::steady_clock;
+        const auto frame_period = std::chrono::duration_cast<clock::duration>(
+            std::chrono::duration<double>(1.0 / FRAME_RATE)
+        );
+
+        auto last_frame = clock::now();
+        auto next_frame = last_frame + frame_period;
+        auto rate_start = last_frame;
+        uint64_t rate_count = 0;
+        uint64_t number = 0;
+
+#if defined(CHIP8_PROFILE)
+        // Attributes the time since the previous mark to a phase
+        auto mark = last_frame;
+        auto attribute = [&](Phase phase){
+            const auto now = clock::now();
+            if(m_profiler){
+                m_profiler->add_time(phase, std::chrono::duration<double>(now - mark).count());
+            }
+            mark = now;
+        };
+        #define CHIP8_PROFILE_PHASE(phase) attribute(phase)
+#else
+        #define CHIP8_PROFILE_PHASE(phase)
+#endif
+
+        while(running.load(std::memory_order_relaxed)){
+            // Emulate a whole frame worth of instructions, then hand the display over.
+            // Rewinding replaces the frame and stops the clock of the program, as does a fault.
+            const bool rewinding = m_renderer->is_rewind_pressed() && rewind_frame();
+            if(rewinding){
+                if(m_recording && !m_recording->keys.empty()){
+                    m_recording->keys.pop_back();
+                }
+            } else if(!m_fault){
+                record_frame();
+                rate_count += run_frame();
+                if(m_recording){
+                    m_recording->keys.push_back(m_keys); // As latched and used by the frame
+                }
+            }
+            CHIP8_PROFILE_PHASE(Phase::EMULATION);
+            Frame& frame = frames.back();
+            frame.first = m_framebuffer;
+            frame.two_planes = bool(m_xo);
+            if(m_xo){
+                frame.second = m_xo->plane;
+                m_xo->plane.clear_dirty();
+            }
+            frame.number = ++number;
+            frames.publish();
+            m_framebuffer.clear_dirty();
+            CHIP8_PROFILE_PHASE(Phase::HANDOFF);
+
+            // Wait for the next frame if running at a fixed clock speed.
+            // If we fall more than a frame behind, resynchronise instead of catching up.
+            if(m_clock_speed != CLOCK_UNTHROTTLED){
+                std::this_thread::sleep_until(next_frame);
+                next_frame += frame_period;
+                if(clock::now() > next_frame){
+                    next_frame = clock::now() + frame_period;
+                }
+            }
+            CHIP8_PROFILE_PHASE(Phase::IDLE);
+
+            // Frames at a fixed clock speed advance the timers by their emulated time,
+            // so that runs can be replayed exactly. Unthrottled frames are as long as they take.
+            auto now = clock::now();
+            if(!rewinding && !m_fault && m_clock_speed == CLOCK_UNTHROTTLED){
+                update_timers(std::chrono::duration<double, std::milli>(now - last_frame).count());
+            }
+            last_frame = now;
+
+            // Measure achieved instruction rate once per second
+            double elapsed = std::chrono::duration<double>(now - rate_start).count();
+            if(elapsed >= 1.0){
+                m_instruction_rate = rate_count / elapsed;
+                rate_count = 0;
+                rate_start = now;
+            }
+        }
+        #undef CHIP8_PROFILE_PHASE
+    }
+
+    void Interpreter::set_recording(Movie* movie){
+        m_recording = movie;
+    }
+
+    void Interpreter::set_rewind_length(std::size_t frames){
+        m_rewind.reset();
+        if(frames != 0){
+            m_rewind = std::make_unique<Rewind>(frames);
+        }
+    }
+
+    void Interpreter::record_frame(){
+        if(m_rewind && !m_xo){
+            Snapshot snapshot;
+            save_state(snapshot);
+            m_rewind->push(snapshot);
+        }
+    }
+
+    bool Interpreter::rewind_frame(){
+        Snapshot snapshot;
+        if(!m_rewind || !m_rewind->pop(snapshot)){
+            return false;
+        }
+        load_state(snapshot);
+        return true;
+    }
+
+    uint64_t Interpreter::run_frame(){
+        uint64_t executed = 0;
+        if(m_fault){
+            return executed;
+        }
+        latch_keys();
+
+        if(m_clock_speed == CLOCK_UNTHROTTLED){
+            // Fill the frame period with as many instructions as possible,
+            // checking the clock only every few instructions.
+            static constexpr int UNTHROTTLED_BATCH = 256;
+            auto deadline = std::chrono::steady_clock::now()
+                + std::chrono::duration<double>(1.0 / FRAME_RATE);
+            do {
+                executed += dispatch(UNTHROTTLED_BATCH);
+            } while(!m_fault && std::chrono::steady_clock::now() < deadline);
+            return executed;
+        }
+
+        // Fractional and overrun cycles are carried over to the next frame
+        m_cycle_budget += m_clock_speed / FRAME_RATE;
+        uint64_t cycles = 0;
+        if(m_uniform_cycles){
+            executed = dispatch(uint64_t(m_cycle_budget));
+            cycles = executed;
+        } else {
+            executed = run_cycles(m_cycle_budget, cycles);
+        }
+        m_cycle_budget -= cycles;
+
+        // Timers follow emulated time, so they keep pace with the program on any host
+        update_timers(1000.0 * cycles / m_clock_speed);
+        return executed;
+    }
+
+    void Interpreter::set_timing(Timing timing){
+        set_cycle_costs(CHIP8::get_cycle_costs(timing));
+    }
+
+    void Interpreter::set_cycle_costs(const CycleCosts& costs){
+        for(uint16_t cycles : costs.op){
+            if(cycles == 0){
+                throw std::runtime_error("Every operation must take at least one cycle");
+            }
+        }
+        m_cycle_costs = costs;
+        m_uniform_cycles = costs.is_uniform();
+    }
+
+    void Interpreter::set_clock_speed(double hz){
+        if(hz < 0.0){
+            throw std::runtime_error("Clock speed must not be negative");
+        }
+        m_clock_speed = hz;
+        m_cycle_budget = 0.0;
+    }
+
     void Interpreter::draw_byte(byte_t x, byte_t y, byte_t byte){
-        bool drawn = m_renderer.draw_byte(x, y, byte);
+        bool drawn = m_framebuffer.draw_byte(x, y, byte);
         if(drawn) m_state.regs[0xF] = 1;
     }
 
     void Interpreter::draw_pixel(uint8_t x, uint8_t y, bool pixel){
-       bool drawn = m_renderer.draw_pixel(x, y, pixel);
+       bool drawn = m_framebuffer.draw_byte(x, y, pixel ? 0x80 : 0x00);
        if(drawn) m_state.regs[0xF] = 1;
 
     }
 
-    /// TODO: set up random number generator
     byte_t Interpreter::random_byte(){
-        std::uniform_int_distribution<byte_t> distribution(0x0, 0xFF);
-        return distribution(m_rng);
+        return m_rng.next_byte();
+    }
+
+    void Interpreter::seed(uint32_t seed){
+        m_rng.seed(seed);
     }
 
     void Interpreter::update_timers(double dt){
         m_timer += dt;
-        if(m_timer < 1000.0/m_timer_freq){
-            return;
-        }
-        m_timer = 0.0;
-        if(m_state.DTreg != 0x0){
-            m_state.DTreg -= 1;
-        }
-
-        if(m_state.STreg != 0x0){
-            m_state.STreg -= 1;
-        }
-    }
-
-    void Interpreter::run_instruction(uint16_t code){
-        
-        // Nibbles
-        byte_t low_nib  = (code & 0x000F);
-        byte_t vy       = (code & 0x00F0) >> 4;
-        byte_t vx       = (code & 0x0F00) >> 8;
-        byte_t high_nib = (code & 0xF000) >> 12;
-        byte_t low_byte = (code & 0x00FF);
-        uint16_t addr   = (code & 0x0FFF);
-        
-        switch(high_nib) {
-            case 0x0:
-                if(code == 0x00E0){ // CLS
-                    m_renderer.clear_canvas();
-                } else if (code == 0x00EE){ // RET
-                    if(m_state.sp == 0){
-                        throw std::runtime_error("No subroutine to return from");
-                    }
-                    m_state.sp--;
-                    m_state.pc = m_state.stack[m_state.sp];
-                }
-                break;
-            case 0x1: // JMP
-                m_state.jump(addr);
-                break;
-            case 0x2: // CALL
-                if(m_state.sp + 1 == STACK_SIZE){
-                    throw std::runtime_error("Stack overflow: subroutine call limit reached");
-                }
-                m_state.stack[m_state.sp] = m_state.pc;
-                m_state.sp++;
-                m_state.pc = addr;
-                break;
-            case 0x3: // SE
-                if(m_state.regs[vx] == low_byte){
-                    m_state.advance();
-                }
-                break;
-            case 0x4: // SNE
-                if(m_state.regs[vx] != low_byte){
-                    m_state.advance();
-                }
-                break;
-            case 0x5: // SE
-                if(m_state.regs[vy] == m_state.regs[vx]){
-                    m_state.advance();
-                }
-                break;
-            case 0x6: // LD
-                m_state.regs[vx]  = low_byte;
-                break;
-            case 0x7: // ADD
-                m_state.regs[vx] += low_byte;
-                break;
-            case 0x8: // Bitwise/arithmetic operations
-                switch(low_nib){
-                    case 0x0: m_state.regs[vx]  = m_state.regs[vy]; break; // LD
-                    case 0x1: m_state.regs[vx] |= m_state.regs[vy]; break; // OR
-                    case 0x2: m_state.regs[vx] &= m_state.regs[vy]; break; // AND
-                    case 0x3: m_state.regs[vx] ^= m_state.regs[vy]; break; // XOR
-                    case 0x4: // ADD
-                        m_state.regs[0xF] = ((m_state.regs[vx] + m_state.regs[vy]) > 0xFF);
-                        m_state.regs[vx] += m_state.regs[vy];
-                        break;
-                    case 0x5: // SUB (VF = NO BORROW)
-                        m_state.regs[0xF] = (m_state.regs[vx] > m_state.regs[vy]);
-                        m_state.regs[vx] -= m_state.regs[vy];
-                        break;
-                    case 0x6: // SHR
-                        m_state.regs[0xF] = (m_state.regs[vx] & 0x1);
-                        m_state.regs[vx] >>= 1;
-                        // m_state.regs[vy] = m_state.regs[vx];
-                        break;
-                    case 0x7: // SUBN
-                        m_state.regs[0xF] = (m_state.regs[vy] > m_state.regs[vx]);
-                        m_state.regs[vx] = m_state.regs[vy] - m_state.regs[vx];
-                        break;
-                    case 0xE: // SHL
-                        m_state.regs[0xF] = (m_state.regs[vx] & 0x80) >> 7;
-                        m_state.regs[vx] <<= 1;
-                        // m_state.regs[vy] = m_state.regs[vx];
-                        break;
-                }
-                break;
-            case 0x9: // SNE
-                if(m_state.regs[vy] != m_state.regs[vx]){
-                    m_state.advance();
-                }
-                break;
-            case 0xA: // LD
-                m_state.Ireg = addr;
-                break;
-            case 0xB: // JMP
-                m_state.jump(addr + m_state.regs[0]);
-                break;
-            case 0xC: // RND
-                m_state.regs[vx] = random_byte() & low_byte;
-                break;
-            case 0xD: { // DRW
-                byte_t x = m_state.regs[vx];
-                byte_t y = m_state.regs[vy];
-                m_state.regs[0xF] = 0;
-                if(m_state.Ireg + low_nib > RAM_SIZE){
-                    throw std::runtime_error("RAM overflow when retrieving font sprite");
-                }
-                for(byte_t i = 0; i != low_nib; ++i){
-                    byte_t sprite_line = m_state.ram[m_state.Ireg + i];
-                    draw_byte(x, y + i, sprite_line);
-                }
-                break;
-            }
-            case 0xE: // Key input
-                switch(low_byte){
-                    case 0x9E: // Skip if key pressed
-                        if(m_renderer.is_key_pressed(m_state.regs[vx])){
-                            m_state.advance();
-                        }
-                        break;
-                    case 0xA1: // Skip if key not pressed
-                        if(!m_renderer.is_key_pressed(m_state.regs[vx])){
-                            m_state.advance();
-                        }
-                        break;
-                }
-                break;
-            case 0xF: // Misc
-                switch(low_byte){
-                    case 0x07:  m_state.regs[vx] = m_state.DTreg; break; //LD
-                    case 0x0A: { // Halt execution until key press
-                        bool key_pressed = false;
-                        for(uint16_t key = 0x0; key != 0x10; ++key){
-                            if(m_renderer.is_key_pressed(key)){
-                                m_state.regs[vx] = byte_t(key);
-                                key_pressed = true;
-                                break;
-                            }
-                        }
-                        if(!key_pressed){
-                            m_state.pc -= 2; // Prevents program counter from advancing
-                        }
-                        break;
-                    }
-                    case 0x15: m_state.DTreg = m_state.regs[vx]; break; // LD
-                    case 0x18: m_state.STreg = m_state.regs[vx]; break; // LD
-                    case 0x1E: m_state.Ireg += m_state.regs[vx]; break; // ADD
-                    case 0x29: m_state.Ireg = m_state.regs[vx] * 5; break; // get digit
-                    case 0x33: // BCD
-                        m_state.ram[m_state.Ireg+2] =  m_state.regs[vx]      % 10;;
-                        m_state.ram[m_state.Ireg+1] = (m_state.regs[vx]/10)  % 10;
-                        m_state.ram[m_state.Ireg]   = (m_state.regs[vx]/100) % 10;
-                        break;
-                    case 0x55: // LD
-                        for(uint16_t i = 0x0; i <= vx; ++i){
-                            m_state.ram[m_state.Ireg + i] = m_state.regs[i];
-                        }
-                        break;
-                    case 0x65: // LD
-                        for(uint16_t i = 0x0; i <= vx; ++i){
-                            m_state.regs[i] = m_state.ram[m_state.Ireg + i];
-                        }
-                        break;
-                }
-                break;
-            default:
-                std::cout << "Invalid opcode " << std::hex << high_nib << std::endl;
-                exit(0);
+        const double period = 1000.0 / m_timer_freq;
+        while(m_timer >= period){
+            m_timer -= period;
+            m_pending_ticks++;
         }
     }
-}
\ No newline at end of file
+
+    void Interpreter::apply_timer_ticks(State& state, uint64_t ticks){
+        state.DTreg = (state.DTreg > ticks) ? byte_t(state.DTreg - ticks) : 0;
+        state.STreg = (state.STreg > ticks) ? byte_t(state.STreg - ticks) : 0;
+    }
+}
@@ -20,49 +20,321 @@ Each step:
 #include <string>
 #include <vector>
 #include <algorithm>
-#include <random>
 #include <ctime>
+#include <chrono>
+#include <memory>
+#include <atomic>
 
-#include <SFML/Graphics.hpp>
 #include "state.h"
 #include "renderer.h"
+#include "framebuffer.h"
+#include "instruction.h"
+#include "jit.h"
+#include "compiled.h"
+#include "quirks.h"
+#include "random.h"
+#include "snapshot.h"
+#include "rewind.h"
+#include "profiler.h"
+#include "timing.h"
+#include "xochip.h"
+#include "fault.h"
+#include "predecode.h"
+#include "triple_buffer.h"
 
 namespace CHIP8 {
+
+    /* Strategies for dispatching decoded instructions to their handlers */
+    enum class Engine {
+        SWITCH,   // Single switch over the operation of each instruction
+        THREADED, // Direct-threaded code (computed goto) where supported
+        JIT,      // Hot blocks recompiled to x86-64, requires CHIP8_ENABLE_JIT
+        AOT,      // Blocks translated ahead of time by chip8_aot, see `load_compiled`
+    };
+
+    template<class Quirks> struct Ops;
+    struct Movie;
     
     class Interpreter {
+        template<class Quirks> friend struct Ops;
+
         State m_state;
-        Renderer m_renderer;
-        std::default_random_engine m_rng;
-        double m_timer;
+        Framebuffer m_framebuffer;
+        std::array<Instruction, RAM_SIZE / 2> m_decoded; // Instruction at each even address
+        std::unique_ptr<Renderer> m_renderer;
+        Random m_rng;
+        double m_timer; // Milliseconds towards the next timer tick
+        uint64_t m_pending_ticks; // Timer ticks not yet applied to DT and ST, see `sync_timers`
         double m_timer_freq; // Hz
+        double m_clock_speed; // Hz, cycles per second
+        double m_cycle_budget; // Cycles owed to the current frame
+        CycleCosts m_cycle_costs;
+        bool m_uniform_cycles; // One cycle per instruction, so frames need no cost lookups
+        double m_instruction_rate; // Hz, measured
+        Fault m_fault; // First fault raised since the last reset, which halts the program
+        uint16_t m_keys; // Keypad as read when the running frame or call started, see `latch_keys`
+        Engine m_engine;
+        Profile m_profile;
+        // Engines instantiated for the quirks of the profile
+        void (Interpreter::*m_execute)(const Instruction& ins);
+        uint64_t (Interpreter::*m_run_switch)(uint64_t count);
+        uint64_t (Interpreter::*m_run_threaded)(uint64_t count);
+#if defined(CHIP8_JIT)
+        std::unique_ptr<Jit> m_jit; // Created when the JIT engine is selected
+#endif
+#if defined(CHIP8_PROFILE)
+        std::unique_ptr<Profiler> m_profiler; // Created by `enable_profiler`
+#endif
+        std::vector<const CompiledBlock*> m_compiled; // Block starting at each address, if any
+        std::vector<uint16_t> m_compiled_coverage;   // Enabled blocks translated from each byte
+        std::unique_ptr<XoChip> m_xo; // Created by the XO-CHIP profile
+        std::unique_ptr<Rewind> m_rewind; // Frames recorded by `run`, if enabled
+        Movie* m_recording; // Keypad of each frame run by `run` is appended here, if set
+
+        /* Applies the timer ticks that elapsed since DT and ST were last brought up to date.
+        Timers only tick between calls to `run_instructions` or `run_cycles`, so this is done
+        once per call and whenever the state is read from outside, never per instruction. */
+        void sync_timers() {
+            if(m_pending_ticks != 0){
+                apply_timer_ticks(m_state, m_pending_ticks);
+                m_pending_ticks = 0;
+            }
+        }
+
+        /* Records a fault raised by `ins`, which was fetched just before the program counter.
+        The handler returns without any other effect and the engine stops after it. */
+        void trap(Trap trap, const Instruction& ins) {
+            m_fault = {trap, uint16_t(m_state.pc - 2), ins.code};
+        }
+
+        /* Puts the program counter back on the faulting instruction.
+        Returns `executed`, the number of instructions that completed before it. */
+        uint64_t stop_at_fault(uint64_t executed) {
+            m_state.pc = m_fault.pc;
+            return executed;
+        }
+
+        /* Reads the keypad once for the instructions about to run. Input arrives on another thread
+        while `run` emulates, so a frame sees the keys it started with, as its movie records them. */
+        void latch_keys() {
+            m_keys = m_renderer->get_keypad().get_keys();
+        }
+
+        /* Executes `count` instructions with the selected engine and the latched keys */
+        uint64_t dispatch(uint64_t count);
+
+        /* Counts `ticks` down from the delay and sound timers of `state`, stopping at zero */
+        static void apply_timer_ticks(State& state, uint64_t ticks);
+
+        /* Returns the instruction at the program counter and advances it.
+        Uncached instructions are decoded into `scratch`. */
+        const Instruction& fetch(Instruction& scratch);
+
+        /* Points the engines at their instantiations for `Quirks` */
+        template<class Quirks> void select_quirks();
+
+        /* Executes a decoded instruction with the quirks of `Quirks` */
+        template<class Quirks> void execute_as(const Instruction& ins);
+
+        /* Executes `count` instructions with the switch engine.
+        Each engine stops early on a fault and returns the number of instructions executed. */
+        template<class Quirks> uint64_t run_switch(uint64_t count);
+
+        /* Executes `count` instructions with the threaded engine */
+        template<class Quirks> uint64_t run_threaded(uint64_t count);
+
+        /* Executes `count` instructions with compiled blocks where available */
+        uint64_t run_jit(uint64_t count);
+
+        /* Executes `count` instructions with blocks compiled ahead of time where available */
+        uint64_t run_compiled(uint64_t count);
+
+        /* Executes instructions one by one until they take `budget` cycles or more.
+        Returns the number of instructions executed and adds their cycles to `cycles`. */
+        uint64_t run_cycles(double budget, uint64_t& cycles);
+
+        /* Executes `count` instructions one by one, recording them in the profiler */
+        uint64_t run_profiled(uint64_t count);
+
+        /* A completed display, handed from the thread running the program to the one presenting it */
+        struct Frame {
+            Framebuffer first;
+            Framebuffer second; // Second bitplane, with the XO-CHIP profile
+            bool two_planes;
+            uint64_t number;    // Counts frames from one, so that skipped frames can be told
+        };
+
+        /* Runs the program a frame at a time on the calling thread, publishing each display
+        to `frames`, until `running` is cleared. The emulation side of `run`. */
+        void emulate(TripleBuffer<Frame>& frames, const std::atomic<bool>& running);
     
     public:
         static constexpr int NATIVE_WIDTH  = 64;
         static constexpr int NATIVE_HEIGHT = 32;
+        static constexpr int HIRES_WIDTH   = Framebuffer::WIDTH;  // SUPER-CHIP high resolution
+        static constexpr int HIRES_HEIGHT  = Framebuffer::HEIGHT;
         static constexpr int SCREEN_SCALE  = 16;
         static constexpr int SCREEN_WIDTH  = NATIVE_WIDTH  * SCREEN_SCALE;
         static constexpr int SCREEN_HEIGHT = NATIVE_HEIGHT * SCREEN_SCALE;
 
+        static constexpr double FRAME_RATE          = 60.0;  // Hz
+        static constexpr double DEFAULT_CLOCK_SPEED = 700.0; // Hz
+        static constexpr double CLOCK_UNTHROTTLED   = 0.0;
+
+        /* Creates an interpreter with a headless display and keypad */
         Interpreter();
 
+        /* Creates an interpreter that draws and reads input through `renderer` */
+        explicit Interpreter(std::unique_ptr<Renderer> renderer);
+
+        ~Interpreter();
+
+        /* Clears memory, registers, display, timers and fault, ready to load another program.
+        The renderer, engine, profile, clock speed and random sequence are kept. */
+        void reset();
+
         /* Retrieve memory of virtual machine */
-        State& get_state() { return m_state; }
+        State& get_state() { sync_timers(); return m_state; }
+
+        /* Retrieve display of virtual machine */
+        Framebuffer& get_framebuffer() { return m_framebuffer; }
+
+        /* Retrieve the memory, second plane and audio of XO-CHIP, or nullptr with another profile */
+        XoChip* get_xo_chip() { return m_xo.get(); }
+
+        /* Retrieve display and input backend */
+        Renderer& get_renderer() { return *m_renderer; }
 
-        /* Loads a CHIP8 program into memory from disk */
+        /* Loads a CHIP8 program into memory from disk, mapping the file rather than reading it.
+        With the XO-CHIP profile, programs may fill the 64 KB address space. */
         void load_file(std::string filename);
 
         /* Loads a CHIP8 program into memory from raw bytes*/
-        void load_bytes(std::vector<byte_t> program);
+        void load_bytes(const std::vector<byte_t>& program);
+
+        /* Loads a CHIP8 program into memory from `size` bytes at `program`, copied straight into RAM */
+        void load_bytes(const byte_t* program, std::size_t size);
+
+        /* Fills the decoded instruction cache from an analysis of the program just loaded,
+        so that it is not decoded as it runs. Instructions that differ from RAM or have no known operation are left out. */
+        void load_predecode(const Predecode& predecode);
+
+        /* Loads a program translated ahead of time and enables its compiled blocks.
+        They are used by the AOT engine until the RAM they were translated from is written. */
+        void load_compiled(const CompiledProgram& program);
 
-        // load_state(filename)
-        // save_state(filename)
+        /* Copies the state of the virtual machine into `snapshot`, with its padding zeroed.
+        Throws with the XO-CHIP profile, whose memory snapshots do not hold. */
+        void save_state(Snapshot& snapshot) const;
 
-        /* Executes the main loop and runs the loaded program */
+        /* Resumes from `snapshot`, clearing any fault. Only decoded and compiled code for
+        the RAM that differs is discarded. Throws if the snapshot is incompatible. */
+        void load_state(const Snapshot& snapshot);
+
+        /* Writes the state of the virtual machine to disk */
+        void save_state(const std::string& filename) const;
+
+        /* Resumes from the first snapshot in a file written by `save_state` */
+        void load_state(const std::string& filename);
+
+        /* Executes the main loop and runs the loaded program.
+        The program runs on a thread of its own while this one presents its frames and handles input,
+        so that the renderer is only used from the calling thread, apart from its keypad and rewind key.
+        While the renderer reports rewind is pressed, recorded frames are played backwards.
+        After a fault the display freezes until the program is rewound or the renderer closes. */
         void run();
 
-        /* Executes an opcode on the current state */
+        /* Appends the keypad of each frame run by `run` to `movie`, or stops if null.
+        The movie must outlive the recording. Rewound frames are removed from it. */
+        void set_recording(Movie* movie);
+
+        /* Records the last `frames` frames run by `run` so that they can be rewound.
+        Zero stops recording and drops the history. */
+        void set_rewind_length(std::size_t frames);
+
+        /* Records the current state as the start of a frame, if rewind is enabled.
+        Nothing is recorded with the XO-CHIP profile. */
+        void record_frame();
+
+        /* Returns to the start of the last recorded frame and drops it.
+        Returns false if no frames are recorded. */
+        bool rewind_frame();
+
+        /* Runs the cycles scheduled for a single 60 Hz frame and advances the
+        timers by the emulated time they took. Cycles left over or overrun are
+        carried to the next frame. Unthrottled frames run for a frame of host
+        time and leave the timers to the caller. Stops at a fault, after which frames run nothing.
+        The keypad is read once, at the start of the frame.
+        Returns the number of instructions executed. */
+        uint64_t run_frame();
+
+        /* Sets the target number of cycles per second, which is the number of
+        instructions per second with uniform timing.
+        Use CLOCK_UNTHROTTLED to run as fast as the host allows. */
+        void set_clock_speed(double hz);
+
+        /* Returns the target number of cycles per second */
+        double get_clock_speed() const { return m_clock_speed; }
+
+        /* Selects the cycle cost of each instruction, see `Timing` */
+        void set_timing(Timing timing);
+
+        /* Sets a custom cycle cost for each instruction */
+        void set_cycle_costs(const CycleCosts& costs);
+
+        /* Returns the cycle cost of each instruction */
+        const CycleCosts& get_cycle_costs() const { return m_cycle_costs; }
+
+        /* Returns the instructions per second achieved over the last second of `run` */
+        double get_instruction_rate() const { return m_instruction_rate; }
+
+        /* Selects the engine used to dispatch instructions.
+        Throws if the JIT is requested but was not compiled in. */
+        void set_engine(Engine engine);
+
+        /* Sets how many times a block must be reached before the JIT compiles it */
+        void set_jit_threshold(uint16_t threshold);
+
+        /* Returns the engine used to dispatch instructions */
+        Engine get_engine() const { return m_engine; }
+
+        /* Selects the quirks programs run with, see `Profile`.
+        Code compiled by the JIT or ahead of time for another profile is discarded. */
+        void set_profile(Profile profile);
+
+        /* Returns the quirk profile programs run with */
+        Profile get_profile() const { return m_profile; }
+
+        /* Starts recording an execution profile, see `Profiler`. While enabled, instructions
+        run one at a time whatever the engine. Throws if the profiler was not compiled in. */
+        void enable_profiler();
+
+        /* Returns the profile recorded so far, or nullptr if the profiler is not enabled */
+        const Profiler* get_profiler() const;
+
+        /* Executes `count` instructions with the selected engine, stopping at a fault.
+        The keypad is read once, before the first instruction.
+        Returns the number of instructions executed, which excludes the faulting one. */
+        uint64_t run_instructions(uint64_t count);
+
+        /* Fetches, decodes and executes the instruction at the program counter, unless halted by a fault.
+        Decoded instructions are cached until the RAM they were read from is written. */
+        void step();
+
+        /* Executes an opcode on the current state.
+        A fault is reported as raised by an instruction just before the program counter. */
         void run_instruction(uint16_t code);
 
+        /* Executes a decoded instruction on the current state, with the keys last latched */
+        void execute(const Instruction& ins);
+
+        /* Discards decoded instructions overlapping `size` bytes of RAM from `address`.
+        Must be called after writing to RAM through `get_state`. */
+        void invalidate_decoded(uint16_t address, uint16_t size);
+
+        /* Discards all decoded instructions */
+        void invalidate_decoded();
+
         /* Draws 8 monochrome pixels encoded as bits in a byte  */
         void draw_byte(byte_t x, byte_t y, byte_t byte);
 
@@ -76,9 +348,27 @@ namespace CHIP8 {
         /* Returns a random integer between 0 and 255 */
         byte_t random_byte();
 
-        /* Advance Delay and Sound timers at a rate of 60 Hz (by default) */
+        /* Restarts the random number sequence, making Cxkk reproducible */
+        void seed(uint32_t seed);
+
+        /* Advances Delay and Sound timers by `dt` milliseconds, ticking at 60 Hz (by default).
+        Time short of the next tick is kept for the next call. Ticks are only counted here
+        and applied to the registers when they are next used. */
         void update_timers(double dt);
 
+        /* Returns the first fault raised since the last reset, false if none.
+        Faults never throw: the faulting instruction has no effect and the program halts on it. */
+        const Fault& get_fault() const { return m_fault; }
+
+        /* Lets a halted program resume, e.g. after its state was corrected through `get_state` */
+        void clear_fault() { m_fault = Fault{Trap::NONE, 0, 0}; }
+
+        /* Returns the current value of the delay timer */
+        byte_t get_delay_timer() { sync_timers(); return m_state.DTreg; }
+
+        /* Returns the current value of the sound timer, the tone plays while it is not zero */
+        byte_t get_sound_timer() { sync_timers(); return m_state.STreg; }
+
     };
 
 }
@@ -0,0 +1,35 @@
+#ifndef CHIP8_COMPILED_H
+#define CHIP8_COMPILED_H
+
+#include <cstdint>
+#include "state.h"
+#include "quirks.h"
+
+namespace CHIP8 {
+
+    class Interpreter;
+
+    /* A block of a program translated to C++ ahead of time by chip8_aot */
+    struct CompiledBlock {
+        uint16_t start;  // Address of first instruction
+        uint16_t end;    // Address after the last byte it was translated from
+        uint16_t length; // Number of CHIP8 instructions executed
+        void (*run)(Interpreter& vm); // Executes the block and sets the program counter, or stops at a fault
+    };
+
+    /* A program translated ahead of time, along with the ROM it was translated from */
+    struct CompiledProgram {
+        const byte_t*        rom;
+        uint16_t             rom_size;
+        const CompiledBlock* blocks;
+        uint16_t             block_count;
+        Profile              profile; // Quirks the blocks were translated with
+    };
+
+    // Longest compiled block, in instructions
+    static constexpr uint16_t COMPILED_BLOCK_MAX_LENGTH = 64;
+
+}
+
+
+#endif /* CHIP8_COMPILED_H */
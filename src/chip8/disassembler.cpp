@@ -0,0 +1,133 @@
+#include "disassembler.h"
+#include <cstdio>
+
+namespace CHIP8 {
+
+    std::string disassemble(const Instruction& ins){
+        char text[32];
+        const unsigned x = ins.x, y = ins.y, n = ins.n, kk = ins.kk, nnn = ins.nnn;
+        switch(ins.op){
+            case Op::SYS:        std::snprintf(text, sizeof(text), "SYS 0x%03X", nnn);              break;
+            case Op::CLS:        return "CLS";
+            case Op::RET:        return "RET";
+            case Op::JP:         std::snprintf(text, sizeof(text), "JP 0x%03X", nnn);               break;
+            case Op::CALL:       std::snprintf(text, sizeof(text), "CALL 0x%03X", nnn);             break;
+            case Op::SE_BYTE:    std::snprintf(text, sizeof(text), "SE V%X, 0x%02X", x, kk);        break;
+            case Op::SNE_BYTE:   std::snprintf(text, sizeof(text), "SNE V%X, 0x%02X", x, kk);       break;
+            case Op::SE_REG:     std::snprintf(text, sizeof(text), "SE V%X, V%X", x, y);            break;
+            case Op::LD_BYTE:    std::snprintf(text, sizeof(text), "LD V%X, 0x%02X", x, kk);        break;
+            case Op::ADD_BYTE:   std::snprintf(text, sizeof(text), "ADD V%X, 0x%02X", x, kk);       break;
+            case Op::LD_REG:     std::snprintf(text, sizeof(text), "LD V%X, V%X", x, y);            break;
+            case Op::OR:         std::snprintf(text, sizeof(text), "OR V%X, V%X", x, y);            break;
+            case Op::AND:        std::snprintf(text, sizeof(text), "AND V%X, V%X", x, y);           break;
+            case Op::XOR:        std::snprintf(text, sizeof(text), "XOR V%X, V%X", x, y);           break;
+            case Op::ADD_REG:    std::snprintf(text, sizeof(text), "ADD V%X, V%X", x, y);           break;
+            case Op::SUB:        std::snprintf(text, sizeof(text), "SUB V%X, V%X", x, y);           break;
+            case Op::SHR:        std::snprintf(text, sizeof(text), "SHR V%X, V%X", x, y);           break;
+            case Op::SUBN:       std::snprintf(text, sizeof(text), "SUBN V%X, V%X", x, y);          break;
+            case Op::SHL:        std::snprintf(text, sizeof(text), "SHL V%X, V%X", x, y);           break;
+            case Op::SNE_REG:    std::snprintf(text, sizeof(text), "SNE V%X, V%X", x, y);           break;
+            case Op::LD_I:       std::snprintf(text, sizeof(text), "LD I, 0x%03X", nnn);            break;
+            case Op::JP_V0:      std::snprintf(text, sizeof(text), "JP V0, 0x%03X", nnn);           break;
+            case Op::RND:        std::snprintf(text, sizeof(text), "RND V%X, 0x%02X", x, kk);       break;
+            case Op::DRW:        std::snprintf(text, sizeof(text), "DRW V%X, V%X, %u", x, y, n);    break;
+            case Op::SKP:        std::snprintf(text, sizeof(text), "SKP V%X", x);                   break;
+            case Op::SKNP:       std::snprintf(text, sizeof(text), "SKNP V%X", x);                  break;
+            case Op::LD_VX_DT:   std::snprintf(text, sizeof(text), "LD V%X, DT", x);                break;
+            case Op::LD_KEY:     std::snprintf(text, sizeof(text), "LD V%X, K", x);                 break;
+            case Op::LD_DT:      std::snprintf(text, sizeof(text), "LD DT, V%X", x);                break;
+            case Op::LD_ST:      std::snprintf(text, sizeof(text), "LD ST, V%X", x);                break;
+            case Op::ADD_I:      std::snprintf(text, sizeof(text), "ADD I, V%X", x);                break;
+            case Op::LD_FONT:    std::snprintf(text, sizeof(text), "LD F, V%X", x);                 break;
+            case Op::LD_BCD:     std::snprintf(text, sizeof(text), "LD B, V%X", x);                 break;
+            case Op::LD_STORE:   std::snprintf(text, sizeof(text), "LD [I], V%X", x);               break;
+            case Op::LD_LOAD:    std::snprintf(text, sizeof(text), "LD V%X, [I]", x);               break;
+            case Op::SCD:        std::snprintf(text, sizeof(text), "SCD %u", n);                    break;
+            case Op::SCR:        return "SCR";
+            case Op::SCL:        return "SCL";
+            case Op::EXIT:       return "EXIT";
+            case Op::LOW:        return "LOW";
+            case Op::HIGH:       return "HIGH";
+            case Op::LD_HF:      std::snprintf(text, sizeof(text), "LD HF, V%X", x);                break;
+            case Op::LD_R:       std::snprintf(text, sizeof(text), "LD R, V%X", x);                 break;
+            case Op::LD_VX_R:    std::snprintf(text, sizeof(text), "LD V%X, R", x);                 break;
+            case Op::LD_I_LONG:  return "LD I, LONG"; // Followed by the address
+            case Op::SAVE_RANGE: std::snprintf(text, sizeof(text), "SAVE V%X - V%X", x, y);         break;
+            case Op::LOAD_RANGE: std::snprintf(text, sizeof(text), "LOAD V%X - V%X", x, y);         break;
+            case Op::PLANE:      std::snprintf(text, sizeof(text), "PLANE %u", x);                  break;
+            case Op::AUDIO:      return "AUDIO";
+            case Op::PITCH:      std::snprintf(text, sizeof(text), "PITCH V%X", x);                 break;
+            default:             std::snprintf(text, sizeof(text), "DW 0x%04X", unsigned(ins.code)); break;
+        }
+        return text;
+    }
+
+    void write_listing(
+        std::ostream& output,
+        const std::array<byte_t, RAM_SIZE>& ram,
+        const ProgramMap& map,
+        uint16_t entry,
+        uint16_t limit
+    ){
+        char line[96];
+        uint32_t addr = entry;
+        while(addr < limit && addr < RAM_SIZE){
+            auto routine = map.routines.find(uint16_t(addr));
+            if(routine != map.routines.end()){
+                output << "\n; " << (addr == entry ? "Entry point" : "Subroutine");
+                if(!routine->second.callees.empty()){
+                    output << ", calls";
+                    for(uint16_t callee : routine->second.callees){
+                        std::snprintf(line, sizeof(line), " 0x%03X", unsigned(callee));
+                        output << line;
+                    }
+                }
+                output << "\n";
+            }
+            auto block = map.code.blocks.find(uint16_t(addr));
+            if(block != map.code.blocks.end()){
+                std::snprintf(line, sizeof(line), "L%03X:\n", unsigned(addr));
+                output << line;
+            }
+
+            if(map.code.instructions[addr] && addr + 1 < RAM_SIZE){
+                const Instruction ins = decode((ram[addr] << 8) | ram[addr + 1]);
+                const char* note = map.indirect_jumps.count(uint16_t(addr)) ? "Indirect jump"
+                    : map.self_modifying.count(uint16_t(addr)) ? "Stores over code" : nullptr;
+                std::snprintf(line, sizeof(line), note ? "    %03X  %04X  %-20s; %s\n" : "    %03X  %04X  %s\n",
+                    unsigned(addr), unsigned(ins.code), disassemble(ins).c_str(), note);
+                output << line;
+                addr += 2;
+                continue;
+            }
+
+            // Data, drawn one pixel per bit if used as a sprite
+            std::snprintf(line, sizeof(line), "    %03X  %02X    DB 0x%02X", unsigned(addr), ram[addr], ram[addr]);
+            output << line;
+            if(map.sprites[addr]){
+                output << "             ; ";
+                for(int bit = 7; bit >= 0; --bit){
+                    output << (((ram[addr] >> bit) & 0x1) ? '#' : '.');
+                }
+            }
+            output << "\n";
+            addr += 1;
+        }
+    }
+
+    void write_block_list(std::ostream& output, const ProgramMap& map){
+        for(const auto& entry : map.code.blocks){
+            const BasicBlock& block = entry.second;
+            bool self_modifying = false;
+            for(uint16_t addr : map.self_modifying){
+                self_modifying |= (addr >= block.start && addr < block.end);
+            }
+            output << "{\"start\": " << block.start << ", \"end\": " << block.end << ", \"successors\": [";
+            for(std::size_t i = 0; i != block.successors.size(); ++i){
+                output << (i ? ", " : "") << block.successors[i];
+            }
+            output << "], \"dynamic\": " << (block.dynamic ? "true" : "false")
+                << ", \"self_modifying\": " << (self_modifying ? "true" : "false") << "}\n";
+        }
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef CHIP8_DISASSEMBLER_H
+#define CHIP8_DISASSEMBLER_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "state.h"
+#include "instruction.h"
+#include "analysis.h"
+
+namespace CHIP8 {
+
+    /* Returns an instruction in assembly, e.g. "LD V1, 0x05" or "DRW V0, V1, 5" */
+    std::string disassemble(const Instruction& ins);
+
+    /*
+    Writes the program in [entry, limit) as assembly. Reachable instructions are listed
+    under a heading for each routine and block, other bytes as data, drawn if used as sprites.
+    Indirect jumps and stores over code are pointed out.
+    */
+    void write_listing(
+        std::ostream& output,
+        const std::array<byte_t, RAM_SIZE>& ram,
+        const ProgramMap& map,
+        uint16_t entry = RAM_PROG_OFFSET,
+        uint16_t limit = RAM_SIZE
+    );
+
+    /*
+    Writes one JSON line per basic block: its start, end, the addresses it may continue at,
+    whether it ends in an indirect jump and whether it writes over code.
+    */
+    void write_block_list(std::ostream& output, const ProgramMap& map);
+
+}
+
+
+#endif /* CHIP8_DISASSEMBLER_H */
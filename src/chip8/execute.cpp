@@ -0,0 +1,961 @@
+#include "chip8.h"
+
+/*
+Execution engines of the interpreter.
+The semantics of each operation are written once in `Ops` and shared by
+the switch engine (`execute_as`) and the threaded engine (`run_threaded`).
+Both are instantiated per quirk policy, so quirks cost no branches when running.
+*/
+
+namespace CHIP8 {
+
+    template<class Q>
+    struct Ops {
+        static constexpr Quirks QUIRKS = Q::value;
+
+        typedef void (*Handler)(Interpreter& vm, const Instruction& ins);
+
+        static void nop(Interpreter&, const Instruction&){ }
+
+        /* Skips the next instruction. On XO-CHIP, F000 nnnn is skipped whole. */
+        static void skip(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if constexpr(QUIRKS.xo_chip){
+                XoChip& xo = *vm.m_xo;
+                const bool long_load = xo.at(st, st.pc) == 0xF0 && xo.at(st, st.pc + 1) == 0x00;
+                st.pc += long_load ? 4 : 2;
+            } else if(!st.advance()){
+                vm.trap(Trap::PC_OUT_OF_RANGE, ins);
+            }
+        }
+
+        /* Calls `f` with each bitplane selected by FN01, only the framebuffer without XO-CHIP */
+        template<class F>
+        static void each_plane(Interpreter& vm, F f){
+            if constexpr(QUIRKS.xo_chip){
+                if(vm.m_xo->planes & 0x1) f(vm.m_framebuffer);
+                if(vm.m_xo->planes & 0x2) f(vm.m_xo->plane);
+            } else {
+                f(vm.m_framebuffer);
+            }
+        }
+
+        static void cls(Interpreter& vm, const Instruction&){
+            each_plane(vm, [](Framebuffer& plane){ plane.clear(); });
+        }
+
+        static void ret(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if(st.sp == 0){
+                vm.trap(Trap::STACK_UNDERFLOW, ins);
+                return;
+            }
+            st.sp--;
+            st.pc = st.stack[st.sp];
+        }
+
+        static void jp(Interpreter& vm, const Instruction& ins){
+            vm.m_state.pc = ins.nnn; // Always within RAM
+        }
+
+        static void call(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if(st.sp + 1 == STACK_SIZE){
+                vm.trap(Trap::STACK_OVERFLOW, ins);
+                return;
+            }
+            st.stack[st.sp] = st.pc;
+            st.sp++;
+            st.pc = ins.nnn;
+        }
+
+        static void se_byte(Interpreter& vm, const Instruction& ins){
+            if(vm.m_state.regs[ins.x] == ins.kk){
+                skip(vm, ins);
+            }
+        }
+
+        static void sne_byte(Interpreter& vm, const Instruction& ins){
+            if(vm.m_state.regs[ins.x] != ins.kk){
+                skip(vm, ins);
+            }
+        }
+
+        static void se_reg(Interpreter& vm, const Instruction& ins){
+            if(vm.m_state.regs[ins.y] == vm.m_state.regs[ins.x]){
+                skip(vm, ins);
+            }
+        }
+
+        static void ld_byte(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] = ins.kk;
+        }
+
+        static void add_byte(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] += ins.kk;
+        }
+
+        static void ld_reg(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] = vm.m_state.regs[ins.y];
+        }
+
+        static void op_or(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] |= vm.m_state.regs[ins.y];
+            if constexpr(QUIRKS.logic_resets_vf){
+                vm.m_state.regs[0xF] = 0;
+            }
+        }
+
+        static void op_and(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] &= vm.m_state.regs[ins.y];
+            if constexpr(QUIRKS.logic_resets_vf){
+                vm.m_state.regs[0xF] = 0;
+            }
+        }
+
+        static void op_xor(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] ^= vm.m_state.regs[ins.y];
+            if constexpr(QUIRKS.logic_resets_vf){
+                vm.m_state.regs[0xF] = 0;
+            }
+        }
+
+        static void add_reg(Interpreter& vm, const Instruction& ins){
+            auto& regs = vm.m_state.regs;
+            regs[0xF] = ((regs[ins.x] + regs[ins.y]) > 0xFF);
+            regs[ins.x] += regs[ins.y];
+        }
+
+        static void sub(Interpreter& vm, const Instruction& ins){ // VF = NO BORROW
+            auto& regs = vm.m_state.regs;
+            regs[0xF] = (regs[ins.x] > regs[ins.y]);
+            regs[ins.x] -= regs[ins.y];
+        }
+
+        static void shr(Interpreter& vm, const Instruction& ins){
+            auto& regs = vm.m_state.regs;
+            const byte_t src = QUIRKS.shift_uses_vy ? ins.y : ins.x;
+            regs[0xF] = (regs[src] & 0x1);
+            regs[ins.x] = regs[src] >> 1;
+        }
+
+        static void subn(Interpreter& vm, const Instruction& ins){
+            auto& regs = vm.m_state.regs;
+            regs[0xF] = (regs[ins.y] > regs[ins.x]);
+            regs[ins.x] = regs[ins.y] - regs[ins.x];
+        }
+
+        static void shl(Interpreter& vm, const Instruction& ins){
+            auto& regs = vm.m_state.regs;
+            const byte_t src = QUIRKS.shift_uses_vy ? ins.y : ins.x;
+            regs[0xF] = (regs[src] & 0x80) >> 7;
+            regs[ins.x] = regs[src] << 1;
+        }
+
+        static void sne_reg(Interpreter& vm, const Instruction& ins){
+            if(vm.m_state.regs[ins.y] != vm.m_state.regs[ins.x]){
+                skip(vm, ins);
+            }
+        }
+
+        static void ld_i(Interpreter& vm, const Instruction& ins){
+            vm.m_state.Ireg = ins.nnn;
+        }
+
+        static void jp_v0(Interpreter& vm, const Instruction& ins){
+            const byte_t offset = QUIRKS.jump_uses_vx ? ins.x : 0x0;
+            if constexpr(QUIRKS.xo_chip){
+                vm.m_state.pc = ins.nnn + vm.m_state.regs[offset]; // Always within 64 KB
+            } else {
+                if(!vm.m_state.jump(ins.nnn + vm.m_state.regs[offset])){
+                    vm.trap(Trap::PC_OUT_OF_RANGE, ins);
+                }
+            }
+        }
+
+        static void rnd(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] = vm.random_byte() & ins.kk;
+        }
+
+        static void drw(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if constexpr(QUIRKS.xo_chip){
+                // Each selected plane draws the next sprite in memory, which wraps at 64 KB
+                XoChip& xo = *vm.m_xo;
+                const uint16_t size = (ins.n == 0) ? 32 : ins.n;
+                uint16_t address = st.Ireg;
+                bool collision = false;
+                each_plane(vm, [&](Framebuffer& plane){
+                    byte_t sprite[32];
+                    for(uint16_t i = 0; i != size; ++i){
+                        sprite[i] = xo.at(st, address++);
+                    }
+                    collision |= (ins.n == 0)
+                        ? plane.draw_sprite_16(st.regs[ins.x], st.regs[ins.y], sprite)
+                        : plane.draw_sprite(st.regs[ins.x], st.regs[ins.y], sprite, ins.n);
+                });
+                st.regs[0xF] = collision;
+                return;
+            }
+            if constexpr(QUIRKS.super_chip){
+                // Dxy0 draws a 16x16 sprite of two bytes per row in high resolution.
+                // In low resolution SUPER-CHIP 1.1 draws 8x16, one byte per row, below.
+                if(ins.n == 0 && vm.m_framebuffer.is_hires()){
+                    if(st.Ireg + 32 > RAM_SIZE){
+                        vm.trap(Trap::MEMORY_OUT_OF_RANGE, ins);
+                        return;
+                    }
+                    st.regs[0xF] = vm.m_framebuffer.draw_sprite_16(
+                        st.regs[ins.x], st.regs[ins.y], st.ram.data() + st.Ireg
+                    );
+                    return;
+                }
+            }
+            const byte_t height = (QUIRKS.super_chip && ins.n == 0) ? 16 : ins.n;
+            if(st.Ireg + height > RAM_SIZE){
+                vm.trap(Trap::MEMORY_OUT_OF_RANGE, ins);
+                return;
+            }
+            st.regs[0xF] = vm.m_framebuffer.draw_sprite(
+                st.regs[ins.x], st.regs[ins.y], st.ram.data() + st.Ireg, height
+            );
+        }
+
+        static void skp(Interpreter& vm, const Instruction& ins){ // Skip if key pressed
+            if((vm.m_keys >> (vm.m_state.regs[ins.x] & 0xF)) & 0x1){
+                skip(vm, ins);
+            }
+        }
+
+        static void sknp(Interpreter& vm, const Instruction& ins){ // Skip if key not pressed
+            if(!((vm.m_keys >> (vm.m_state.regs[ins.x] & 0xF)) & 0x1)){
+                skip(vm, ins);
+            }
+        }
+
+        static void ld_vx_dt(Interpreter& vm, const Instruction& ins){
+            vm.m_state.regs[ins.x] = vm.m_state.DTreg;
+        }
+
+        static void ld_key(Interpreter& vm, const Instruction& ins){ // Halt execution until key press
+            const uint16_t keys = vm.m_keys;
+            if(keys == 0){
+                vm.m_state.pc -= 2; // Prevents program counter from advancing
+                return;
+            }
+            byte_t key = 0x0; // Lowest key pressed
+            while(!((keys >> key) & 0x1)){
+                ++key;
+            }
+            vm.m_state.regs[ins.x] = key;
+        }
+
+        static void ld_dt(Interpreter& vm, const Instruction& ins){
+            vm.m_state.DTreg = vm.m_state.regs[ins.x];
+        }
+
+        static void ld_st(Interpreter& vm, const Instruction& ins){
+            vm.m_state.STreg = vm.m_state.regs[ins.x];
+        }
+
+        static void add_i(Interpreter& vm, const Instruction& ins){
+            vm.m_state.Ireg += vm.m_state.regs[ins.x];
+        }
+
+        static void ld_font(Interpreter& vm, const Instruction& ins){ // get digit
+            vm.m_state.Ireg = vm.m_state.regs[ins.x] * 5;
+        }
+
+        static void ld_bcd(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if constexpr(QUIRKS.xo_chip){
+                XoChip& xo = *vm.m_xo;
+                xo.at(st, st.Ireg + 2) =  st.regs[ins.x]      % 10;
+                xo.at(st, st.Ireg + 1) = (st.regs[ins.x]/10)  % 10;
+                xo.at(st, st.Ireg)     = (st.regs[ins.x]/100) % 10;
+                vm.invalidate_decoded(st.Ireg, 3);
+                return;
+            }
+            if(st.Ireg + 3 > RAM_SIZE){
+                vm.trap(Trap::MEMORY_OUT_OF_RANGE, ins);
+                return;
+            }
+            st.ram[st.Ireg+2] =  st.regs[ins.x]      % 10;
+            st.ram[st.Ireg+1] = (st.regs[ins.x]/10)  % 10;
+            st.ram[st.Ireg]   = (st.regs[ins.x]/100) % 10;
+            vm.invalidate_decoded(st.Ireg, 3);
+        }
+
+        static void ld_store(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if(!in_memory(vm, ins, ins.x + 1)){
+                return;
+            }
+            for(uint16_t i = 0x0; i <= ins.x; ++i){
+                memory(vm, st.Ireg + i) = st.regs[i];
+            }
+            vm.invalidate_decoded(st.Ireg, ins.x + 1);
+            increment_i(st, ins);
+        }
+
+        static void ld_load(Interpreter& vm, const Instruction& ins){
+            State& st = vm.m_state;
+            if(!in_memory(vm, ins, ins.x + 1)){
+                return;
+            }
+            for(uint16_t i = 0x0; i <= ins.x; ++i){
+                st.regs[i] = memory(vm, st.Ireg + i);
+            }
+            increment_i(st, ins);
+        }
+
+        /*
+        SUPER-CHIP operations. Without the quirk their opcodes are
+        machine code routines (00Cn, 00FB-00FF) or unknown (Fx30, Fx75, Fx85), and ignored.
+        */
+
+        static void scd(Interpreter& vm, const Instruction& ins){ // Scroll down n rows
+            if constexpr(QUIRKS.super_chip){
+                each_plane(vm, [&](Framebuffer& plane){ plane.scroll_down(ins.n); });
+            }
+        }
+
+        static void scr(Interpreter& vm, const Instruction&){ // Scroll right 4 pixels
+            if constexpr(QUIRKS.super_chip){
+                each_plane(vm, [](Framebuffer& plane){ plane.scroll_right(); });
+            }
+        }
+
+        static void scl(Interpreter& vm, const Instruction&){ // Scroll left 4 pixels
+            if constexpr(QUIRKS.super_chip){
+                each_plane(vm, [](Framebuffer& plane){ plane.scroll_left(); });
+            }
+        }
+
+        static void op_exit(Interpreter& vm, const Instruction&){ // Stop the program
+            if constexpr(QUIRKS.super_chip){
+                vm.m_state.pc -= 2; // Stays on this instruction, like Fx0A without a key
+            }
+        }
+
+        static void low(Interpreter& vm, const Instruction&){
+            if constexpr(QUIRKS.super_chip){
+                vm.m_framebuffer.set_hires(false);
+                if constexpr(QUIRKS.xo_chip){
+                    vm.m_xo->plane.set_hires(false);
+                }
+            }
+        }
+
+        static void high(Interpreter& vm, const Instruction&){
+            if constexpr(QUIRKS.super_chip){
+                vm.m_framebuffer.set_hires(true);
+                if constexpr(QUIRKS.xo_chip){
+                    vm.m_xo->plane.set_hires(true);
+                }
+            }
+        }
+
+        static void ld_hf(Interpreter& vm, const Instruction& ins){ // get large digit
+            if constexpr(QUIRKS.super_chip){
+                vm.m_state.Ireg = BIG_HEX_ALPHABET_OFFSET + vm.m_state.regs[ins.x] * BIG_HEX_DIGIT_SIZE;
+            }
+        }
+
+        static void ld_r(Interpreter& vm, const Instruction& ins){ // Save V0-Vx to the user flags
+            if constexpr(QUIRKS.super_chip){
+                State& st = vm.m_state;
+                std::copy_n(st.regs.begin(), ins.x + 1, st.rpl.begin());
+            }
+        }
+
+        static void ld_vx_r(Interpreter& vm, const Instruction& ins){ // Restore V0-Vx from the user flags
+            if constexpr(QUIRKS.super_chip){
+                State& st = vm.m_state;
+                std::copy_n(st.rpl.begin(), ins.x + 1, st.regs.begin());
+            }
+        }
+
+        /*
+        XO-CHIP operations. Without the quirk, 5xy2 and 5xy3 are 5xy0
+        as on the COSMAC VIP, and the others are unknown opcodes, ignored.
+        */
+
+        static void ld_i_long(Interpreter& vm, const Instruction&){ // I = next 16 bits
+            if constexpr(QUIRKS.xo_chip){
+                State& st = vm.m_state;
+                st.Ireg = (memory(vm, st.pc) << 8) | memory(vm, st.pc + 1);
+                st.pc += 2;
+            }
+        }
+
+        static void save_range(Interpreter& vm, const Instruction& ins){ // Store Vx-Vy at I, in either order
+            if constexpr(QUIRKS.xo_chip){
+                State& st = vm.m_state;
+                const int step = (ins.x <= ins.y) ? 1 : -1;
+                uint16_t address = st.Ireg;
+                for(int i = ins.x; i != ins.y + step; i += step){
+                    memory(vm, address++) = st.regs[i];
+                }
+                vm.invalidate_decoded(st.Ireg, std::abs(ins.y - ins.x) + 1);
+            } else {
+                se_reg(vm, ins);
+            }
+        }
+
+        static void load_range(Interpreter& vm, const Instruction& ins){ // Load Vx-Vy from I, in either order
+            if constexpr(QUIRKS.xo_chip){
+                State& st = vm.m_state;
+                const int step = (ins.x <= ins.y) ? 1 : -1;
+                uint16_t address = st.Ireg;
+                for(int i = ins.x; i != ins.y + step; i += step){
+                    st.regs[i] = memory(vm, address++);
+                }
+            } else {
+                se_reg(vm, ins);
+            }
+        }
+
+        static void plane(Interpreter& vm, const Instruction& ins){ // Select the planes drawn to
+            if constexpr(QUIRKS.xo_chip){
+                vm.m_xo->planes = ins.x & 0x3;
+            }
+        }
+
+        static void audio(Interpreter& vm, const Instruction&){ // Load the audio pattern from I
+            if constexpr(QUIRKS.xo_chip){
+                State& st = vm.m_state;
+                for(uint16_t i = 0; i != AUDIO_PATTERN_SIZE; ++i){
+                    vm.m_xo->pattern[i] = memory(vm, st.Ireg + i);
+                }
+            }
+        }
+
+        static void pitch(Interpreter& vm, const Instruction& ins){
+            if constexpr(QUIRKS.xo_chip){
+                vm.m_xo->pitch = vm.m_state.regs[ins.x];
+            }
+        }
+
+        /* Returns true if `size` bytes from I are addressable, raising a fault otherwise.
+        The 64 KB of XO-CHIP wrap around instead. */
+        static bool in_memory(Interpreter& vm, const Instruction& ins, uint32_t size){
+            if constexpr(!QUIRKS.xo_chip){
+                if(vm.m_state.Ireg + size > RAM_SIZE){
+                    vm.trap(Trap::MEMORY_OUT_OF_RANGE, ins);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /* Returns a byte of RAM, of the 64 KB address space on XO-CHIP */
+        static byte_t& memory(Interpreter& vm, uint16_t address){
+            if constexpr(QUIRKS.xo_chip){
+                return vm.m_xo->at(vm.m_state, address);
+            } else {
+                return vm.m_state.ram[address];
+            }
+        }
+
+        static void increment_i(State& st, const Instruction& ins){
+            if constexpr(QUIRKS.memory_increment == MemoryIncrement::X){
+                st.Ireg += ins.x;
+            } else if constexpr(QUIRKS.memory_increment == MemoryIncrement::X_PLUS_ONE){
+                st.Ireg += ins.x + 1;
+            }
+        }
+
+        /* Handlers indexed by operation, in the order of `Op` */
+        static constexpr Handler HANDLERS[] = {
+            nop,      nop,      nop,     cls,     ret,
+            jp,       call,     se_byte, sne_byte, se_reg,
+            ld_byte,  add_byte, ld_reg,  op_or,   op_and,
+            op_xor,   add_reg,  sub,     shr,     subn,
+            shl,      sne_reg,  ld_i,    jp_v0,   rnd,
+            drw,      skp,      sknp,    ld_vx_dt, ld_key,
+            ld_dt,    ld_st,    add_i,   ld_font, ld_bcd,
+            ld_store, ld_load,  scd,     scr,     scl,
+            op_exit,  low,      high,    ld_hf,   ld_r,
+            ld_vx_r,  ld_i_long, save_range, load_range, plane,
+            audio,    pitch,
+        };
+        static_assert(
+            sizeof(HANDLERS) / sizeof(Handler) == std::size_t(Op::COUNT),
+            "One handler is required per operation"
+        );
+    };
+
+
+    const Instruction& Interpreter::fetch(Instruction& scratch){
+        const uint16_t pc = m_state.pc;
+
+        // Odd addresses, the end of RAM and XO-CHIP memory past it are not cached
+        if((pc & 0x1) || pc + 2 >= RAM_SIZE){
+            if(m_xo){
+                scratch = decode((m_xo->at(m_state, pc) << 8) | m_xo->at(m_state, pc + 1));
+                m_state.pc += 2;
+            } else if(m_state.advance()){
+                scratch = decode((m_state.ram[pc] << 8) | m_state.ram[pc + 1]);
+            } else {
+                // Fault on the last bytes of RAM and run nothing, the engine stops after it
+                const uint16_t code = (m_state.ram[pc] << 8) | ((pc + 1 < RAM_SIZE) ? m_state.ram[pc + 1] : 0);
+                m_fault = {Trap::PC_OUT_OF_RANGE, pc, code};
+                scratch = decode(0x0000);
+            }
+            return scratch;
+        }
+
+        Instruction& ins = m_decoded[pc >> 1];
+        if(ins.op == Op::UNDECODED){
+            ins = decode((m_state.ram[pc] << 8) | m_state.ram[pc + 1]);
+        }
+        m_state.pc += 2;
+        return ins;
+    }
+
+    void Interpreter::step(){
+        latch_keys();
+        sync_timers();
+        if(m_fault){
+            return;
+        }
+        Instruction scratch;
+        (this->*m_execute)(fetch(scratch));
+        if(m_fault){
+            stop_at_fault(0);
+        }
+    }
+
+    void Interpreter::run_instruction(uint16_t code){
+        latch_keys();
+        execute(decode(code));
+    }
+
+    template<class Quirks>
+    void Interpreter::select_quirks(){
+        m_execute      = &Interpreter::execute_as<Quirks>;
+        m_run_switch   = &Interpreter::run_switch<Quirks>;
+        m_run_threaded = &Interpreter::run_threaded<Quirks>;
+    }
+
+    void Interpreter::set_profile(Profile profile){
+        switch(profile){
+            case Profile::DEFAULT:    select_quirks<DefaultQuirks>();   break;
+            case Profile::COSMAC_VIP: select_quirks<CosmacVipQuirks>(); break;
+            case Profile::CHIP48:     select_quirks<Chip48Quirks>();    break;
+            case Profile::SCHIP:      select_quirks<SchipQuirks>();     break;
+            case Profile::XO_CHIP:    select_quirks<XoChipQuirks>();    break;
+        }
+        if(profile == Profile::XO_CHIP && !m_xo){
+            m_xo = std::make_unique<XoChip>();
+        } else if(profile != Profile::XO_CHIP){
+            m_xo.reset();
+        }
+        if(profile != m_profile){
+            // Compiled code bakes in the quirks of the previous profile
+            m_compiled.clear();
+            m_compiled_coverage.clear();
+#if defined(CHIP8_JIT)
+            if(m_jit){
+                m_jit->set_quirks(get_quirks(profile));
+            }
+#endif
+        }
+        m_profile = profile;
+    }
+
+    void Interpreter::set_engine(Engine engine){
+        if(engine == Engine::JIT){
+#if defined(CHIP8_JIT)
+            if(!m_jit){
+                m_jit = std::make_unique<Jit>(get_quirks(m_profile));
+            }
+#else
+            throw std::runtime_error("JIT support was not compiled in");
+#endif
+        }
+        m_engine = engine;
+    }
+
+    void Interpreter::set_jit_threshold(uint16_t threshold){
+#if defined(CHIP8_JIT)
+        if(!m_jit){
+            m_jit = std::make_unique<Jit>(get_quirks(m_profile));
+        }
+        m_jit->set_threshold(threshold);
+#else
+        (void)threshold;
+#endif
+    }
+
+    void Interpreter::enable_profiler(){
+#if defined(CHIP8_PROFILE)
+        if(!m_profiler){
+            m_profiler = std::make_unique<Profiler>();
+        }
+#else
+        throw std::runtime_error("Profiler support was not compiled in");
+#endif
+    }
+
+    const Profiler* Interpreter::get_profiler() const {
+#if defined(CHIP8_PROFILE)
+        return m_profiler.get();
+#else
+        return nullptr;
+#endif
+    }
+
+    uint64_t Interpreter::run_instructions(uint64_t count){
+        latch_keys();
+        return dispatch(count);
+    }
+
+    uint64_t Interpreter::dispatch(uint64_t count){
+        sync_timers();
+        if(m_fault){
+            return 0;
+        }
+#if defined(CHIP8_PROFILE)
+        if(m_profiler){
+            return run_profiled(count);
+        }
+#endif
+        switch(m_engine){
+            case Engine::SWITCH:   return (this->*m_run_switch)(count);
+            case Engine::THREADED: return (this->*m_run_threaded)(count);
+            case Engine::JIT:      return run_jit(count);
+            case Engine::AOT:      return run_compiled(count);
+        }
+        return 0;
+    }
+
+    void Interpreter::invalidate_decoded(uint16_t address, uint16_t size){
+        // XO-CHIP memory past RAM_SIZE is never decoded ahead
+        if(size == 0 || address >= RAM_SIZE){
+            return;
+        }
+        // A byte at `address` belongs to the instruction cached at `address & ~1`
+        uint16_t first = address >> 1;
+        uint16_t last  = std::min<uint32_t>((uint32_t(address) + size - 1) >> 1, m_decoded.size() - 1);
+        for(uint16_t i = first; i <= last; ++i){
+            m_decoded[i].op = Op::UNDECODED;
+        }
+#if defined(CHIP8_JIT)
+        if(m_jit){
+            m_jit->invalidate(address, size);
+        }
+#endif
+        if(!m_compiled.empty()){
+            // Disable compiled blocks that were translated from the written bytes
+            const uint32_t end = std::min<uint32_t>(uint32_t(address) + size, RAM_SIZE);
+            const bool covered = std::any_of(
+                m_compiled_coverage.begin() + address, m_compiled_coverage.begin() + end,
+                [](uint16_t blocks){ return blocks != 0; }
+            );
+            const uint32_t window = 2 * COMPILED_BLOCK_MAX_LENGTH;
+            for(uint32_t start = (address > window) ? address - window : 0; covered && start < end; ++start){
+                const CompiledBlock* block = m_compiled[start];
+                if(block != nullptr && block->end > address){
+                    m_compiled[start] = nullptr;
+                    for(uint16_t addr = block->start; addr != block->end; ++addr){
+                        m_compiled_coverage[addr]--;
+                    }
+                }
+            }
+        }
+    }
+
+    void Interpreter::invalidate_decoded(){
+        for(Instruction& ins : m_decoded){
+            ins.op = Op::UNDECODED;
+        }
+#if defined(CHIP8_JIT)
+        if(m_jit){
+            m_jit->reset();
+        }
+#endif
+        m_compiled.clear();
+        m_compiled_coverage.clear();
+    }
+
+    void Interpreter::execute(const Instruction& ins){
+        sync_timers();
+        (this->*m_execute)(ins);
+    }
+
+    template<class Quirks>
+    uint64_t Interpreter::run_switch(uint64_t count){
+        Instruction scratch;
+        for(uint64_t i = 0; i != count; ++i){
+            execute_as<Quirks>(fetch(scratch));
+            if(m_fault){
+                return stop_at_fault(i);
+            }
+        }
+        return count;
+    }
+
+    template<class Quirks>
+    void Interpreter::execute_as(const Instruction& ins){
+        typedef CHIP8::Ops<Quirks> Ops;
+        switch(ins.op) {
+            case Op::UNDECODED:
+            case Op::UNKNOWN:
+            case Op::SYS:
+            case Op::COUNT:    Ops::nop(*this, ins);      break;
+            case Op::CLS:      Ops::cls(*this, ins);      break;
+            case Op::RET:      Ops::ret(*this, ins);      break;
+            case Op::JP:       Ops::jp(*this, ins);       break;
+            case Op::CALL:     Ops::call(*this, ins);     break;
+            case Op::SE_BYTE:  Ops::se_byte(*this, ins);  break;
+            case Op::SNE_BYTE: Ops::sne_byte(*this, ins); break;
+            case Op::SE_REG:   Ops::se_reg(*this, ins);   break;
+            case Op::LD_BYTE:  Ops::ld_byte(*this, ins);  break;
+            case Op::ADD_BYTE: Ops::add_byte(*this, ins); break;
+            case Op::LD_REG:   Ops::ld_reg(*this, ins);   break;
+            case Op::OR:       Ops::op_or(*this, ins);    break;
+            case Op::AND:      Ops::op_and(*this, ins);   break;
+            case Op::XOR:      Ops::op_xor(*this, ins);   break;
+            case Op::ADD_REG:  Ops::add_reg(*this, ins);  break;
+            case Op::SUB:      Ops::sub(*this, ins);      break;
+            case Op::SHR:      Ops::shr(*this, ins);      break;
+            case Op::SUBN:     Ops::subn(*this, ins);     break;
+            case Op::SHL:      Ops::shl(*this, ins);      break;
+            case Op::SNE_REG:  Ops::sne_reg(*this, ins);  break;
+            case Op::LD_I:     Ops::ld_i(*this, ins);     break;
+            case Op::JP_V0:    Ops::jp_v0(*this, ins);    break;
+            case Op::RND:      Ops::rnd(*this, ins);      break;
+            case Op::DRW:      Ops::drw(*this, ins);      break;
+            case Op::SKP:      Ops::skp(*this, ins);      break;
+            case Op::SKNP:     Ops::sknp(*this, ins);     break;
+            case Op::LD_VX_DT: Ops::ld_vx_dt(*this, ins); break;
+            case Op::LD_KEY:   Ops::ld_key(*this, ins);   break;
+            case Op::LD_DT:    Ops::ld_dt(*this, ins);    break;
+            case Op::LD_ST:    Ops::ld_st(*this, ins);    break;
+            case Op::ADD_I:    Ops::add_i(*this, ins);    break;
+            case Op::LD_FONT:  Ops::ld_font(*this, ins);  break;
+            case Op::LD_BCD:   Ops::ld_bcd(*this, ins);   break;
+            case Op::LD_STORE: Ops::ld_store(*this, ins); break;
+            case Op::LD_LOAD:  Ops::ld_load(*this, ins);  break;
+            case Op::SCD:      Ops::scd(*this, ins);      break;
+            case Op::SCR:      Ops::scr(*this, ins);      break;
+            case Op::SCL:      Ops::scl(*this, ins);      break;
+            case Op::EXIT:     Ops::op_exit(*this, ins);  break;
+            case Op::LOW:      Ops::low(*this, ins);      break;
+            case Op::HIGH:     Ops::high(*this, ins);     break;
+            case Op::LD_HF:    Ops::ld_hf(*this, ins);    break;
+            case Op::LD_R:     Ops::ld_r(*this, ins);     break;
+            case Op::LD_VX_R:  Ops::ld_vx_r(*this, ins);  break;
+            case Op::LD_I_LONG:  Ops::ld_i_long(*this, ins);  break;
+            case Op::SAVE_RANGE: Ops::save_range(*this, ins); break;
+            case Op::LOAD_RANGE: Ops::load_range(*this, ins); break;
+            case Op::PLANE:      Ops::plane(*this, ins);      break;
+            case Op::AUDIO:      Ops::audio(*this, ins);      break;
+            case Op::PITCH:      Ops::pitch(*this, ins);      break;
+        }
+    }
+
+    template<class Quirks>
+    uint64_t Interpreter::run_threaded(uint64_t count){
+        typedef CHIP8::Ops<Quirks> Ops;
+        Instruction scratch;
+        const Instruction* ins;
+        const uint64_t total = count;
+
+#if defined(__GNUC__)
+        // Direct threading: every handler ends with its own indirect jump
+        // to the next one, giving the branch predictor one site per operation.
+        static void* const LABELS[] = {
+            &&l_nop,      &&l_nop,      &&l_nop,     &&l_cls,      &&l_ret,
+            &&l_jp,       &&l_call,     &&l_se_byte, &&l_sne_byte, &&l_se_reg,
+            &&l_ld_byte,  &&l_add_byte, &&l_ld_reg,  &&l_or,       &&l_and,
+            &&l_xor,      &&l_add_reg,  &&l_sub,     &&l_shr,      &&l_subn,
+            &&l_shl,      &&l_sne_reg,  &&l_ld_i,    &&l_jp_v0,    &&l_rnd,
+            &&l_drw,      &&l_skp,      &&l_sknp,    &&l_ld_vx_dt, &&l_ld_key,
+            &&l_ld_dt,    &&l_ld_st,    &&l_add_i,   &&l_ld_font,  &&l_ld_bcd,
+            &&l_ld_store, &&l_ld_load,  &&l_scd,     &&l_scr,      &&l_scl,
+            &&l_exit,     &&l_low,      &&l_high,    &&l_ld_hf,    &&l_ld_r,
+            &&l_ld_vx_r,  &&l_ld_i_long, &&l_save_range, &&l_load_range, &&l_plane,
+            &&l_audio,    &&l_pitch,
+        };
+        static_assert(
+            sizeof(LABELS) / sizeof(void*) == std::size_t(Op::COUNT),
+            "One label is required per operation"
+        );
+
+        #define CHIP8_DISPATCH()                                  \
+            if(count-- == 0) return total;                        \
+            ins = &fetch(scratch);                                \
+            goto *LABELS[static_cast<std::size_t>(ins->op)];
+
+        // Only operations that may fault check for one, the others dispatch unconditionally.
+        // Fetching past the end of RAM faults too, and runs a nop.
+        #define CHIP8_DISPATCH_CHECKED()                          \
+            if(m_fault) return stop_at_fault(total - count - 1);  \
+            CHIP8_DISPATCH();
+
+        CHIP8_DISPATCH();
+        l_nop:      Ops::nop(*this, *ins);      CHIP8_DISPATCH_CHECKED();
+        l_cls:      Ops::cls(*this, *ins);      CHIP8_DISPATCH();
+        l_ret:      Ops::ret(*this, *ins);      CHIP8_DISPATCH_CHECKED();
+        l_jp:       Ops::jp(*this, *ins);       CHIP8_DISPATCH();
+        l_call:     Ops::call(*this, *ins);     CHIP8_DISPATCH_CHECKED();
+        l_se_byte:  Ops::se_byte(*this, *ins);  CHIP8_DISPATCH_CHECKED();
+        l_sne_byte: Ops::sne_byte(*this, *ins); CHIP8_DISPATCH_CHECKED();
+        l_se_reg:   Ops::se_reg(*this, *ins);   CHIP8_DISPATCH_CHECKED();
+        l_ld_byte:  Ops::ld_byte(*this, *ins);  CHIP8_DISPATCH();
+        l_add_byte: Ops::add_byte(*this, *ins); CHIP8_DISPATCH();
+        l_ld_reg:   Ops::ld_reg(*this, *ins);   CHIP8_DISPATCH();
+        l_or:       Ops::op_or(*this, *ins);    CHIP8_DISPATCH();
+        l_and:      Ops::op_and(*this, *ins);   CHIP8_DISPATCH();
+        l_xor:      Ops::op_xor(*this, *ins);   CHIP8_DISPATCH();
+        l_add_reg:  Ops::add_reg(*this, *ins);  CHIP8_DISPATCH();
+        l_sub:      Ops::sub(*this, *ins);      CHIP8_DISPATCH();
+        l_shr:      Ops::shr(*this, *ins);      CHIP8_DISPATCH();
+        l_subn:     Ops::subn(*this, *ins);     CHIP8_DISPATCH();
+        l_shl:      Ops::shl(*this, *ins);      CHIP8_DISPATCH();
+        l_sne_reg:  Ops::sne_reg(*this, *ins);  CHIP8_DISPATCH_CHECKED();
+        l_ld_i:     Ops::ld_i(*this, *ins);     CHIP8_DISPATCH();
+        l_jp_v0:    Ops::jp_v0(*this, *ins);    CHIP8_DISPATCH_CHECKED();
+        l_rnd:      Ops::rnd(*this, *ins);      CHIP8_DISPATCH();
+        l_drw:      Ops::drw(*this, *ins);      CHIP8_DISPATCH_CHECKED();
+        l_skp:      Ops::skp(*this, *ins);      CHIP8_DISPATCH_CHECKED();
+        l_sknp:     Ops::sknp(*this, *ins);     CHIP8_DISPATCH_CHECKED();
+        l_ld_vx_dt: Ops::ld_vx_dt(*this, *ins); CHIP8_DISPATCH();
+        l_ld_key:   Ops::ld_key(*this, *ins);   CHIP8_DISPATCH();
+        l_ld_dt:    Ops::ld_dt(*this, *ins);    CHIP8_DISPATCH();
+        l_ld_st:    Ops::ld_st(*this, *ins);    CHIP8_DISPATCH();
+        l_add_i:    Ops::add_i(*this, *ins);    CHIP8_DISPATCH();
+        l_ld_font:  Ops::ld_font(*this, *ins);  CHIP8_DISPATCH();
+        l_ld_bcd:   Ops::ld_bcd(*this, *ins);   CHIP8_DISPATCH_CHECKED();
+        l_ld_store: Ops::ld_store(*this, *ins); CHIP8_DISPATCH_CHECKED();
+        l_ld_load:  Ops::ld_load(*this, *ins);  CHIP8_DISPATCH_CHECKED();
+        l_scd:      Ops::scd(*this, *ins);      CHIP8_DISPATCH();
+        l_scr:      Ops::scr(*this, *ins);      CHIP8_DISPATCH();
+        l_scl:      Ops::scl(*this, *ins);      CHIP8_DISPATCH();
+        l_exit:     Ops::op_exit(*this, *ins);  CHIP8_DISPATCH();
+        l_low:      Ops::low(*this, *ins);      CHIP8_DISPATCH();
+        l_high:     Ops::high(*this, *ins);     CHIP8_DISPATCH();
+        l_ld_hf:    Ops::ld_hf(*this, *ins);    CHIP8_DISPATCH();
+        l_ld_r:     Ops::ld_r(*this, *ins);     CHIP8_DISPATCH();
+        l_ld_vx_r:  Ops::ld_vx_r(*this, *ins);  CHIP8_DISPATCH();
+        l_ld_i_long:  Ops::ld_i_long(*this, *ins);  CHIP8_DISPATCH();
+        l_save_range: Ops::save_range(*this, *ins); CHIP8_DISPATCH_CHECKED();
+        l_load_range: Ops::load_range(*this, *ins); CHIP8_DISPATCH_CHECKED();
+        l_plane:      Ops::plane(*this, *ins);      CHIP8_DISPATCH();
+        l_audio:      Ops::audio(*this, *ins);      CHIP8_DISPATCH();
+        l_pitch:      Ops::pitch(*this, *ins);      CHIP8_DISPATCH();
+
+        #undef CHIP8_DISPATCH_CHECKED
+        #undef CHIP8_DISPATCH
+#else
+        // Call threading through the handler table
+        while(count-- != 0){
+            ins = &fetch(scratch);
+            Ops::HANDLERS[static_cast<std::size_t>(ins->op)](*this, *ins);
+            if(m_fault){
+                return stop_at_fault(total - count - 1);
+            }
+        }
+        return total;
+#endif
+    }
+
+    uint64_t Interpreter::run_jit(uint64_t count){
+#if defined(CHIP8_JIT)
+        // Whole blocks run natively when they fit in the remaining count,
+        // everything else goes through the reference interpreter.
+        // Compiled blocks hold no instruction that can fault.
+        Instruction scratch;
+        uint64_t executed = 0;
+        while(executed != count){
+            const Jit::Block* block = m_jit->lookup(m_state, m_state.pc);
+            if(block != nullptr && block->length <= count - executed){
+                block->fn(&m_state);
+                executed += block->length;
+            } else {
+                (this->*m_execute)(fetch(scratch));
+                if(m_fault){
+                    return stop_at_fault(executed);
+                }
+                ++executed;
+            }
+        }
+        return executed;
+#else
+        return (this->*m_run_threaded)(count);
+#endif
+    }
+
+    uint64_t Interpreter::run_cycles(double budget, uint64_t& cycles){
+        // Costs depend on the instruction, so they run one at a time through the switch engine.
+        // The last one may overrun the budget, which the caller carries to the next frame.
+        sync_timers();
+        Instruction scratch;
+        uint64_t executed = 0;
+        uint64_t spent = 0;
+        while(spent < budget){
+            const Instruction& ins = fetch(scratch);
+            const uint32_t cost = m_cycle_costs.of(ins);
+#if defined(CHIP8_PROFILE)
+            if(m_profiler){
+                m_profiler->record(m_state.pc - 2, ins, m_state);
+            }
+#endif
+            (this->*m_execute)(ins);
+            if(m_fault){
+                stop_at_fault(executed);
+                break;
+            }
+            spent += cost;
+            executed++;
+        }
+        cycles += spent;
+        return executed;
+    }
+
+    uint64_t Interpreter::run_profiled(uint64_t count){
+#if defined(CHIP8_PROFILE)
+        Instruction scratch;
+        for(uint64_t i = 0; i != count; ++i){
+            const uint16_t pc = m_state.pc;
+            const Instruction& ins = fetch(scratch);
+            m_profiler->record(pc, ins, m_state);
+            (this->*m_execute)(ins);
+            if(m_fault){
+                return stop_at_fault(i);
+            }
+        }
+        return count;
+#else
+        return (this->*m_run_switch)(count);
+#endif
+    }
+
+    uint64_t Interpreter::run_compiled(uint64_t count){
+        // Same scheme as the JIT: whole blocks when they fit in the count,
+        // the interpreter for anything that was not or is no longer compiled.
+        Instruction scratch;
+        uint64_t executed = 0;
+        while(executed != count){
+            const CompiledBlock* block = (m_state.pc < m_compiled.size()) ? m_compiled[m_state.pc] : nullptr;
+            if(block != nullptr && block->length <= count - executed){
+                block->run(*this);
+                if(m_fault){
+                    // Blocks are straight-line code, so the fault tells how far it ran
+                    return stop_at_fault(executed + (m_fault.pc - block->start) / 2);
+                }
+                executed += block->length;
+            } else {
+                (this->*m_execute)(fetch(scratch));
+                if(m_fault){
+                    return stop_at_fault(executed);
+                }
+                ++executed;
+            }
+        }
+        return executed;
+    }
+}
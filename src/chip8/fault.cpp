@@ -0,0 +1,22 @@
+#include "fault.h"
+#include <cstdio>
+
+namespace CHIP8 {
+
+    const char* trap_name(Trap trap){
+        switch(trap){
+            case Trap::STACK_OVERFLOW:      return "Stack overflow: subroutine call limit reached";
+            case Trap::STACK_UNDERFLOW:     return "No subroutine to return from";
+            case Trap::PC_OUT_OF_RANGE:     return "Program counter past the end of RAM";
+            case Trap::MEMORY_OUT_OF_RANGE: return "RAM overflow";
+            case Trap::NONE:                break;
+        }
+        return "No fault";
+    }
+
+    std::string describe_fault(const Fault& fault){
+        char location[40];
+        std::snprintf(location, sizeof(location), " at 0x%04X (opcode 0x%04X)", fault.pc, fault.opcode);
+        return trap_name(fault.trap) + std::string(location);
+    }
+}
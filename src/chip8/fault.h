@@ -0,0 +1,40 @@
+#ifndef CHIP8_FAULT_H
+#define CHIP8_FAULT_H
+
+#include <string>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /* Why a program was stopped by the virtual machine */
+    enum class Trap : byte_t {
+        NONE,
+        STACK_OVERFLOW,      // 2NNN with a full stack
+        STACK_UNDERFLOW,     // 00EE with no subroutine to return from
+        PC_OUT_OF_RANGE,     // Fetching, skipping or jumping past the end of RAM
+        MEMORY_OUT_OF_RANGE, // DXYN, FX33, FX55 or FX65 reaching past the end of RAM
+    };
+
+    /*
+    First fault raised by a program. The faulting instruction has no effect
+    and the program counter is left on it.
+    */
+    struct Fault {
+        Trap     trap;
+        uint16_t pc;     // Address of the faulting instruction
+        uint16_t opcode; // Faulting instruction, as far as it could be read
+
+        /* True if a fault was raised */
+        explicit operator bool() const { return trap != Trap::NONE; }
+    };
+
+    /* Returns a description of a trap, e.g. "Stack overflow" */
+    const char* trap_name(Trap trap);
+
+    /* Returns the trap, address and opcode of a fault, e.g. "Stack overflow at 0x0204 (opcode 0x2204)" */
+    std::string describe_fault(const Fault& fault);
+
+}
+
+
+#endif /* CHIP8_FAULT_H */
@@ -0,0 +1,144 @@
+#include "framebuffer.h"
+#include <cstring>
+#include <utility>
+
+namespace CHIP8 {
+
+    /* Turns off all pixels */
+    void Framebuffer::clear(){
+        for(int y = 0; y != HEIGHT; ++y){
+            m_dirty |= mask_t((m_rows[y] | m_right[y]) != 0) << y;
+        }
+        std::memset(m_rows.data(), 0, sizeof(m_rows));
+        std::memset(m_right.data(), 0, sizeof(m_right));
+    }
+
+    /* Switches between low and high resolution. The display is cleared if the resolution changes. */
+    void Framebuffer::set_hires(bool hires){
+        if(hires != is_hires()){
+            m_hires = hires;
+            clear();
+            mark_all_dirty();
+        }
+    }
+
+    /* XORs `width` bits, most significant first, onto row `y` from column `x` */
+    bool Framebuffer::draw_bits(byte_t x, byte_t y, row_t bits, unsigned width){
+        y %= get_height();
+        if(!is_hires()){
+            // Place the bits on the leftmost pixels and rotate them into position
+            const unsigned shift = x % LORES_WIDTH;
+            const row_t line = bits << (64 - width);
+            const row_t pixels = (line >> shift) | (line << ((64 - shift) % 64));
+
+            row_t& row = m_rows[y];
+            bool collision = (row & pixels) != 0;
+            row ^= pixels;
+            m_dirty |= mask_t(pixels != 0) << y;
+            return collision;
+        }
+
+        // Same rotation across the two words of a high resolution row
+        unsigned shift = x % WIDTH;
+        row_t left = bits << (64 - width);
+        row_t right = 0;
+        if(shift >= 64){
+            std::swap(left, right);
+            shift -= 64;
+        }
+        if(shift != 0){
+            const row_t carry_left = left << (64 - shift);
+            left  = (left >> shift) | (right << (64 - shift));
+            right = (right >> shift) | carry_left;
+        }
+
+        bool collision = ((m_rows[y] & left) | (m_right[y] & right)) != 0;
+        m_rows[y]  ^= left;
+        m_right[y] ^= right;
+        m_dirty |= mask_t((left | right) != 0) << y;
+        return collision;
+    }
+
+    /* XORs a byte onto the row `y` using the bits as pixels, starting at column `x`.
+    Pixels wrap around the screen. Returns True if a pixel was erased. */
+    bool Framebuffer::draw_byte(byte_t x, byte_t y, byte_t byte){
+        return draw_bits(x, y, byte, 8);
+    }
+
+    /* Draws `height` bytes of a sprite, one per row, starting at (x,y).
+    Returns True if a pixel was erased. */
+    bool Framebuffer::draw_sprite(byte_t x, byte_t y, const byte_t* sprite, byte_t height){
+        bool collision = false;
+        for(byte_t i = 0; i != height; ++i){
+            collision |= draw_bits(x, y + i, sprite[i], 8);
+        }
+        return collision;
+    }
+
+    /* Draws a 16x16 sprite stored as two bytes per row, starting at (x,y).
+    Returns True if a pixel was erased. */
+    bool Framebuffer::draw_sprite_16(byte_t x, byte_t y, const byte_t* sprite){
+        bool collision = false;
+        for(byte_t i = 0; i != 16; ++i){
+            const row_t bits = (row_t(sprite[2 * i]) << 8) | sprite[2 * i + 1];
+            collision |= draw_bits(x, y + i, bits, 16);
+        }
+        return collision;
+    }
+
+    /* Moves the display down by `rows`, blanking the rows at the top */
+    void Framebuffer::scroll_down(byte_t rows){
+        const int height = get_height();
+        if(rows == 0){
+            return;
+        }
+        if(rows >= height){
+            clear();
+            return;
+        }
+        std::memmove(m_rows.data() + rows, m_rows.data(), (height - rows) * sizeof(row_t));
+        std::memmove(m_right.data() + rows, m_right.data(), (height - rows) * sizeof(row_t));
+        std::memset(m_rows.data(), 0, rows * sizeof(row_t));
+        std::memset(m_right.data(), 0, rows * sizeof(row_t));
+        mark_all_dirty();
+    }
+
+    /* Moves the display 4 pixels to the right, blanking the leftmost columns */
+    void Framebuffer::scroll_right(){
+        const int height = get_height();
+        if(is_hires()){
+            for(int y = 0; y != height; ++y){
+                m_right[y] = (m_right[y] >> 4) | (m_rows[y] << 60);
+                m_rows[y] >>= 4;
+            }
+        } else {
+            for(int y = 0; y != height; ++y){
+                m_rows[y] >>= 4;
+            }
+        }
+        mark_all_dirty();
+    }
+
+    /* Moves the display 4 pixels to the left, blanking the rightmost columns */
+    void Framebuffer::scroll_left(){
+        const int height = get_height();
+        if(is_hires()){
+            for(int y = 0; y != height; ++y){
+                m_rows[y] = (m_rows[y] << 4) | (m_right[y] >> 60);
+                m_right[y] <<= 4;
+            }
+        } else {
+            for(int y = 0; y != height; ++y){
+                m_rows[y] <<= 4;
+            }
+        }
+        mark_all_dirty();
+    }
+
+    /* Returns true if the pixel at (x,y) is lit */
+    bool Framebuffer::get_pixel(byte_t x, byte_t y) const {
+        const unsigned column = x % get_width();
+        const row_t word = get_row(y % get_height(), column / 64);
+        return (word >> (63 - column % 64)) & 0x1;
+    }
+}
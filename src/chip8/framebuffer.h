@@ -0,0 +1,102 @@
+#ifndef CHIP8_FRAMEBUFFER_H
+#define CHIP8_FRAMEBUFFER_H
+
+#include <array>
+#include <cstdint>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /*
+    Monochrome display of the virtual machine.
+    It shows 64x32 pixels in low resolution and 128x64 in the high
+    resolution of SUPER-CHIP. Each scanline is stored as 64-bit words,
+    one in low resolution and two in high, with the leftmost pixel in the
+    most significant bit, so that sprites are drawn with one rotate, XOR
+    and AND per row and the screen scrolls a whole word at a time.
+    Rows changed since the last call to `clear_dirty` are tracked
+    so that renderers only upload what changed.
+    */
+    class Framebuffer {
+
+    public:
+        static constexpr int WIDTH  = 128; // Largest size, in high resolution
+        static constexpr int HEIGHT = 64;
+        static constexpr int LORES_WIDTH  = 64;
+        static constexpr int LORES_HEIGHT = 32;
+
+        typedef uint64_t row_t;
+        typedef uint64_t mask_t; // One bit per row, bit `y` for row `y`
+
+    private:
+        std::array<row_t, HEIGHT> m_rows;  // Columns 0-63 of each row
+        std::array<row_t, HEIGHT> m_right; // Columns 64-127, high resolution only
+        mask_t m_dirty;
+        uint64_t m_hires; // Non-zero in high resolution, a word to keep the layout free of padding
+
+        /* XORs `width` bits, most significant first, onto row `y` from column `x` */
+        bool draw_bits(byte_t x, byte_t y, row_t bits, unsigned width);
+
+    public:
+        Framebuffer() : m_rows{}, m_right{}, m_dirty(0), m_hires(0) { mark_all_dirty(); }
+
+        /* Turns off all pixels */
+        void clear();
+
+        /* Switches between low and high resolution. The display is cleared if the resolution changes. */
+        void set_hires(bool hires);
+
+        /* True in high resolution */
+        bool is_hires() const { return m_hires != 0; }
+
+        /* Returns the number of columns in the current resolution */
+        int get_width() const { return is_hires() ? WIDTH : LORES_WIDTH; }
+
+        /* Returns the number of rows in the current resolution */
+        int get_height() const { return is_hires() ? HEIGHT : LORES_HEIGHT; }
+
+        /* XORs a byte onto the row `y` using the bits as pixels, starting at column `x`.
+        Pixels wrap around the screen. Returns True if a pixel was erased. */
+        bool draw_byte(byte_t x, byte_t y, byte_t byte);
+
+        /* Draws `height` bytes of a sprite, one per row, starting at (x,y).
+        Returns True if a pixel was erased. */
+        bool draw_sprite(byte_t x, byte_t y, const byte_t* sprite, byte_t height);
+
+        /* Draws a 16x16 sprite stored as two bytes per row, starting at (x,y).
+        Returns True if a pixel was erased. */
+        bool draw_sprite_16(byte_t x, byte_t y, const byte_t* sprite);
+
+        /* Moves the display down by `rows`, blanking the rows at the top */
+        void scroll_down(byte_t rows);
+
+        /* Moves the display 4 pixels to the right, blanking the leftmost columns */
+        void scroll_right();
+
+        /* Moves the display 4 pixels to the left, blanking the rightmost columns */
+        void scroll_left();
+
+        /* Returns true if the pixel at (x,y) is lit */
+        bool get_pixel(byte_t x, byte_t y) const;
+
+        /* Returns 64 pixels of a scanline, leftmost pixel in the most significant bit.
+        Word 0 holds columns 0-63, which is the whole row in low resolution,
+        and word 1 holds columns 64-127. */
+        row_t get_row(byte_t y, int word = 0) const {
+            return (word == 0) ? m_rows[y % HEIGHT] : m_right[y % HEIGHT];
+        }
+
+        /* Returns a mask of the rows modified since the last call to `clear_dirty` */
+        mask_t get_dirty_rows() const { return m_dirty; }
+
+        /* Marks every row as presented */
+        void clear_dirty() { m_dirty = 0; }
+
+        /* Marks every row as modified, e.g. to force a full redraw */
+        void mark_all_dirty() { m_dirty = ~mask_t(0) >> (64 - get_height()); }
+
+    };
+}
+
+
+#endif /* CHIP8_FRAMEBUFFER_H */
@@ -0,0 +1,38 @@
+#include "headless_renderer.h"
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    /* Marks the backend as running */
+    void HeadlessRenderer::init(){
+        if(m_running){
+            throw std::runtime_error("Renderer already initialised");
+        }
+        m_running = true;
+    }
+
+    /* True between `init` and `close` */
+    bool HeadlessRenderer::is_running(){
+        return m_running;
+    }
+
+    /* Nothing to present, always returns zero */
+    double HeadlessRenderer::update(const Framebuffer&){
+        return 0.0;
+    }
+
+    /* Presses or releases a keypad key */
+    void HeadlessRenderer::set_key(byte_t key, bool pressed){
+        m_keypad.set_key(key, pressed);
+    }
+
+    /* Replaces the keys being pressed, bit k for key k */
+    void HeadlessRenderer::set_keys(uint16_t keys){
+        m_keypad.set_keys(keys);
+    }
+
+    /* Stops the main loop at the end of the current frame */
+    void HeadlessRenderer::close(){
+        m_running = false;
+    }
+}
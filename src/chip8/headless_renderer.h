@@ -0,0 +1,41 @@
+#ifndef CHIP8_HEADLESS_RENDERER_H
+#define CHIP8_HEADLESS_RENDERER_H
+
+#include "renderer.h"
+
+namespace CHIP8 {
+
+    /*
+    Runs without a display: the framebuffer is only kept by the interpreter.
+    The keypad is driven by the caller through `set_key`.
+    */
+    class HeadlessRenderer : public Renderer {
+        bool m_running;
+
+    public:
+        HeadlessRenderer() : m_running(false) { }
+
+        /* Marks the backend as running */
+        void init() override;
+
+        /* True between `init` and `close` */
+        bool is_running() override;
+
+        /* Nothing to present, always returns zero */
+        double update(const Framebuffer& framebuffer) override;
+        using Renderer::update;
+
+        /* Presses or releases a keypad key */
+        void set_key(byte_t key, bool pressed);
+
+        /* Replaces the keys being pressed, bit k for key k */
+        void set_keys(uint16_t keys);
+
+        /* Stops the main loop at the end of the current frame */
+        void close();
+
+    };
+}
+
+
+#endif /* CHIP8_HEADLESS_RENDERER_H */
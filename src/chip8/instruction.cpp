@@ -0,0 +1,110 @@
+#include "instruction.h"
+
+namespace CHIP8 {
+
+    /* Extracts the operation and operands of an opcode */
+    Instruction decode(uint16_t code){
+        Instruction ins;
+        ins.code = code;
+        ins.n    = (code & 0x000F);
+        ins.y    = (code & 0x00F0) >> 4;
+        ins.x    = (code & 0x0F00) >> 8;
+        ins.kk   = (code & 0x00FF);
+        ins.nnn  = (code & 0x0FFF);
+        ins.op   = Op::UNKNOWN;
+
+        switch((code & 0xF000) >> 12){
+            case 0x0:
+                if(code == 0x00E0)      ins.op = Op::CLS;
+                else if(code == 0x00EE) ins.op = Op::RET;
+                else if((code & 0xFFF0) == 0x00C0) ins.op = Op::SCD;
+                else if(code == 0x00FB) ins.op = Op::SCR;
+                else if(code == 0x00FC) ins.op = Op::SCL;
+                else if(code == 0x00FD) ins.op = Op::EXIT;
+                else if(code == 0x00FE) ins.op = Op::LOW;
+                else if(code == 0x00FF) ins.op = Op::HIGH;
+                else                    ins.op = Op::SYS;
+                break;
+            case 0x1: ins.op = Op::JP;       break;
+            case 0x2: ins.op = Op::CALL;     break;
+            case 0x3: ins.op = Op::SE_BYTE;  break;
+            case 0x4: ins.op = Op::SNE_BYTE; break;
+            case 0x5:
+                switch(ins.n){
+                    case 0x2: ins.op = Op::SAVE_RANGE; break;
+                    case 0x3: ins.op = Op::LOAD_RANGE; break;
+                    default:  ins.op = Op::SE_REG;     break;
+                }
+                break;
+            case 0x6: ins.op = Op::LD_BYTE;  break;
+            case 0x7: ins.op = Op::ADD_BYTE; break;
+            case 0x8:
+                switch(ins.n){
+                    case 0x0: ins.op = Op::LD_REG;  break;
+                    case 0x1: ins.op = Op::OR;      break;
+                    case 0x2: ins.op = Op::AND;     break;
+                    case 0x3: ins.op = Op::XOR;     break;
+                    case 0x4: ins.op = Op::ADD_REG; break;
+                    case 0x5: ins.op = Op::SUB;     break;
+                    case 0x6: ins.op = Op::SHR;     break;
+                    case 0x7: ins.op = Op::SUBN;    break;
+                    case 0xE: ins.op = Op::SHL;     break;
+                }
+                break;
+            case 0x9: ins.op = Op::SNE_REG; break;
+            case 0xA: ins.op = Op::LD_I;    break;
+            case 0xB: ins.op = Op::JP_V0;   break;
+            case 0xC: ins.op = Op::RND;     break;
+            case 0xD: ins.op = Op::DRW;     break;
+            case 0xE:
+                switch(ins.kk){
+                    case 0x9E: ins.op = Op::SKP;  break;
+                    case 0xA1: ins.op = Op::SKNP; break;
+                }
+                break;
+            case 0xF:
+                switch(ins.kk){
+                    case 0x00: if(code == 0xF000) ins.op = Op::LD_I_LONG; break;
+                    case 0x01: ins.op = Op::PLANE;    break;
+                    case 0x02: if(code == 0xF002) ins.op = Op::AUDIO; break;
+                    case 0x07: ins.op = Op::LD_VX_DT; break;
+                    case 0x0A: ins.op = Op::LD_KEY;   break;
+                    case 0x15: ins.op = Op::LD_DT;    break;
+                    case 0x18: ins.op = Op::LD_ST;    break;
+                    case 0x1E: ins.op = Op::ADD_I;    break;
+                    case 0x29: ins.op = Op::LD_FONT;  break;
+                    case 0x30: ins.op = Op::LD_HF;    break;
+                    case 0x3A: ins.op = Op::PITCH;    break;
+                    case 0x33: ins.op = Op::LD_BCD;   break;
+                    case 0x55: ins.op = Op::LD_STORE; break;
+                    case 0x65: ins.op = Op::LD_LOAD;  break;
+                    case 0x75: ins.op = Op::LD_R;     break;
+                    case 0x85: ins.op = Op::LD_VX_R;  break;
+                }
+                break;
+        }
+        return ins;
+    }
+
+    /* Returns the name of an operation as written in `Op`, e.g. "LD_BYTE" */
+    const char* op_name(Op op){
+        static const char* const NAMES[] = {
+            "UNDECODED", "UNKNOWN",  "SYS",      "CLS",      "RET",
+            "JP",        "CALL",     "SE_BYTE",  "SNE_BYTE", "SE_REG",
+            "LD_BYTE",   "ADD_BYTE", "LD_REG",   "OR",       "AND",
+            "XOR",       "ADD_REG",  "SUB",      "SHR",      "SUBN",
+            "SHL",       "SNE_REG",  "LD_I",     "JP_V0",    "RND",
+            "DRW",       "SKP",      "SKNP",     "LD_VX_DT", "LD_KEY",
+            "LD_DT",     "LD_ST",    "ADD_I",    "LD_FONT",  "LD_BCD",
+            "LD_STORE",  "LD_LOAD",  "SCD",      "SCR",      "SCL",
+            "EXIT",      "LOW",      "HIGH",     "LD_HF",    "LD_R",
+            "LD_VX_R",   "LD_I_LONG", "SAVE_RANGE", "LOAD_RANGE", "PLANE",
+            "AUDIO",     "PITCH",
+        };
+        static_assert(
+            sizeof(NAMES) / sizeof(NAMES[0]) == std::size_t(Op::COUNT),
+            "One name is required per operation"
+        );
+        return (op < Op::COUNT) ? NAMES[std::size_t(op)] : "INVALID";
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef CHIP8_INSTRUCTION_H
+#define CHIP8_INSTRUCTION_H
+
+#include <cstdint>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /* Operations of the CHIP8 instruction set */
+    enum class Op : byte_t {
+        UNDECODED,  // Placeholder for instructions not decoded yet
+        UNKNOWN,    // Opcode with no defined behaviour, ignored
+        SYS,        // 0nnn - Machine code routine, ignored
+        CLS,        // 00E0
+        RET,        // 00EE
+        JP,         // 1nnn
+        CALL,       // 2nnn
+        SE_BYTE,    // 3xkk
+        SNE_BYTE,   // 4xkk
+        SE_REG,     // 5xy0
+        LD_BYTE,    // 6xkk
+        ADD_BYTE,   // 7xkk
+        LD_REG,     // 8xy0
+        OR,         // 8xy1
+        AND,        // 8xy2
+        XOR,        // 8xy3
+        ADD_REG,    // 8xy4
+        SUB,        // 8xy5
+        SHR,        // 8xy6
+        SUBN,       // 8xy7
+        SHL,        // 8xyE
+        SNE_REG,    // 9xy0
+        LD_I,       // Annn
+        JP_V0,      // Bnnn
+        RND,        // Cxkk
+        DRW,        // Dxyn
+        SKP,        // Ex9E
+        SKNP,       // ExA1
+        LD_VX_DT,   // Fx07
+        LD_KEY,     // Fx0A
+        LD_DT,      // Fx15
+        LD_ST,      // Fx18
+        ADD_I,      // Fx1E
+        LD_FONT,    // Fx29
+        LD_BCD,     // Fx33
+        LD_STORE,   // Fx55
+        LD_LOAD,    // Fx65
+        // SUPER-CHIP
+        SCD,        // 00Cn
+        SCR,        // 00FB
+        SCL,        // 00FC
+        EXIT,       // 00FD
+        LOW,        // 00FE
+        HIGH,       // 00FF
+        LD_HF,      // Fx30
+        LD_R,       // Fx75
+        LD_VX_R,    // Fx85
+        // XO-CHIP
+        LD_I_LONG,  // F000 nnnn
+        SAVE_RANGE, // 5xy2
+        LOAD_RANGE, // 5xy3
+        PLANE,      // Fn01
+        AUDIO,      // F002
+        PITCH,      // Fx3A
+        COUNT
+    };
+
+    /* An opcode split into its operation and operands */
+    struct Instruction {
+        Op       op;
+        byte_t   x;    // Second nibble, register index
+        byte_t   y;    // Third nibble, register index
+        byte_t   n;    // Lowest nibble
+        byte_t   kk;   // Lowest byte
+        uint16_t nnn;  // Lowest 12 bits, address
+        uint16_t code; // Original opcode
+    };
+
+    /* Extracts the operation and operands of an opcode */
+    Instruction decode(uint16_t code);
+
+    /* Returns the name of an operation as written in `Op`, e.g. "LD_BYTE" */
+    const char* op_name(Op op);
+
+}
+
+
+#endif /* CHIP8_INSTRUCTION_H */
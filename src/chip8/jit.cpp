@@ -0,0 +1,276 @@
+#include "jit.h"
+
+#if defined(CHIP8_JIT)
+
+#include "instruction.h"
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <sys/mman.h>
+
+namespace CHIP8 {
+
+    namespace {
+
+        // Largest amount of machine code a single block can take
+        constexpr std::size_t MAX_BLOCK_BYTES = 4096;
+
+        // Displacements of State members from the state pointer (rdi)
+        int32_t reg_offset(byte_t x) { return int32_t(offsetof(State, regs) + x); }
+        constexpr int32_t OFFSET_VF = int32_t(offsetof(State, regs) + 0xF);
+        constexpr int32_t OFFSET_I  = int32_t(offsetof(State, Ireg));
+        constexpr int32_t OFFSET_DT = int32_t(offsetof(State, DTreg));
+        constexpr int32_t OFFSET_ST = int32_t(offsetof(State, STreg));
+        constexpr int32_t OFFSET_PC = int32_t(offsetof(State, pc));
+
+        /*
+        Writes x86-64 instructions whose memory operand is [rdi + disp32].
+        Only al/ax/eax and cl are used as scratch registers.
+        */
+        class Emitter {
+            byte_t* m_out;
+
+            void u8(uint8_t value)   { *m_out++ = value; }
+            void u16(uint16_t value) { std::memcpy(m_out, &value, 2); m_out += 2; }
+            void u32(int32_t value)  { std::memcpy(m_out, &value, 4); m_out += 4; }
+
+            // ModRM byte for [rdi + disp32] with `reg` as register/extension field
+            void mem(uint8_t reg, int32_t disp) { u8(0x87 | (reg << 3)); u32(disp); }
+
+        public:
+            explicit Emitter(byte_t* out) : m_out(out) { }
+            byte_t* position() const { return m_out; }
+
+            void mov_m8_imm(int32_t d, uint8_t imm)   { u8(0xC6); mem(0, d); u8(imm); }
+            void add_m8_imm(int32_t d, uint8_t imm)   { u8(0x80); mem(0, d); u8(imm); }
+            void cmp_m8_imm(int32_t d, uint8_t imm)   { u8(0x80); mem(7, d); u8(imm); }
+            void mov_m16_imm(int32_t d, uint16_t imm) { u8(0x66); u8(0xC7); mem(0, d); u16(imm); }
+
+            void mov_al_m8(int32_t d) { u8(0x8A); mem(0, d); }
+            void add_al_m8(int32_t d) { u8(0x02); mem(0, d); }
+            void sub_al_m8(int32_t d) { u8(0x2A); mem(0, d); }
+            void cmp_al_m8(int32_t d) { u8(0x3A); mem(0, d); }
+            void mov_m8_al(int32_t d) { u8(0x88); mem(0, d); }
+            void mov_m8_cl(int32_t d) { u8(0x88); mem(1, d); }
+            void or_m8_al(int32_t d)  { u8(0x08); mem(0, d); }
+            void and_m8_al(int32_t d) { u8(0x20); mem(0, d); }
+            void xor_m8_al(int32_t d) { u8(0x30); mem(0, d); }
+
+            void movzx_eax_m8(int32_t d) { u8(0x0F); u8(0xB6); mem(0, d); }
+            void add_m16_ax(int32_t d)   { u8(0x66); u8(0x01); mem(0, d); }
+            void mov_m16_ax(int32_t d)   { u8(0x66); u8(0x89); mem(0, d); }
+            void lea_eax_rax_x5()        { u8(0x8D); u8(0x04); u8(0x80); }
+
+            void and_al_imm(uint8_t imm) { u8(0x24); u8(imm); }
+            void shr_al_imm(uint8_t imm) { u8(0xC0); u8(0xE8); u8(imm); }
+            void shl_al_imm(uint8_t imm) { u8(0xC0); u8(0xE0); u8(imm); }
+            void setc_cl()               { u8(0x0F); u8(0x92); u8(0xC1); }
+            void seta_cl()               { u8(0x0F); u8(0x97); u8(0xC1); }
+
+            // Short conditional jumps, patched with `land`
+            byte_t* je()  { u8(0x74); u8(0); return m_out - 1; }
+            byte_t* jne() { u8(0x75); u8(0); return m_out - 1; }
+            void land(byte_t* jump) { *jump = byte_t(m_out - (jump + 1)); }
+
+            void ret() { u8(0xC3); }
+        };
+
+        /* Emits the VF reset of logical operations, if the quirks require it */
+        void reset_vf(Emitter& e, const Quirks& quirks){
+            if(quirks.logic_resets_vf){
+                e.mov_m8_imm(OFFSET_VF, 0);
+            }
+        }
+
+        /* Emits the body of a straight-line instruction. Returns false if unsupported. */
+        bool emit_straight(Emitter& e, const Instruction& ins, const Quirks& quirks){
+            const int32_t vx = reg_offset(ins.x);
+            const int32_t vy = reg_offset(ins.y);
+            const int32_t shifted = quirks.shift_uses_vy ? vy : vx;
+
+            // Flag-setting operations write VF first and then re-read their
+            // operands, exactly like the interpreter, so that VF operands behave the same.
+            switch(ins.op){
+                case Op::SYS:
+                case Op::UNKNOWN:
+                    return true;
+                case Op::LD_BYTE:  e.mov_m8_imm(vx, ins.kk); return true;
+                case Op::ADD_BYTE: e.add_m8_imm(vx, ins.kk); return true;
+                case Op::LD_REG:   e.mov_al_m8(vy); e.mov_m8_al(vx); return true;
+                case Op::OR:       e.mov_al_m8(vy); e.or_m8_al(vx);  reset_vf(e, quirks); return true;
+                case Op::AND:      e.mov_al_m8(vy); e.and_m8_al(vx); reset_vf(e, quirks); return true;
+                case Op::XOR:      e.mov_al_m8(vy); e.xor_m8_al(vx); reset_vf(e, quirks); return true;
+                case Op::ADD_REG:
+                    e.mov_al_m8(vx); e.add_al_m8(vy); e.setc_cl(); e.mov_m8_cl(OFFSET_VF);
+                    e.mov_al_m8(vx); e.add_al_m8(vy); e.mov_m8_al(vx);
+                    return true;
+                case Op::SUB:
+                    e.mov_al_m8(vx); e.cmp_al_m8(vy); e.seta_cl(); e.mov_m8_cl(OFFSET_VF);
+                    e.mov_al_m8(vx); e.sub_al_m8(vy); e.mov_m8_al(vx);
+                    return true;
+                case Op::SUBN:
+                    e.mov_al_m8(vy); e.cmp_al_m8(vx); e.seta_cl(); e.mov_m8_cl(OFFSET_VF);
+                    e.mov_al_m8(vy); e.sub_al_m8(vx); e.mov_m8_al(vx);
+                    return true;
+                case Op::SHR:
+                    e.mov_al_m8(shifted); e.and_al_imm(0x1); e.mov_m8_al(OFFSET_VF);
+                    e.mov_al_m8(shifted); e.shr_al_imm(1); e.mov_m8_al(vx);
+                    return true;
+                case Op::SHL:
+                    e.mov_al_m8(shifted); e.shr_al_imm(7); e.mov_m8_al(OFFSET_VF);
+                    e.mov_al_m8(shifted); e.shl_al_imm(1); e.mov_m8_al(vx);
+                    return true;
+                case Op::LD_I:     e.mov_m16_imm(OFFSET_I, ins.nnn); return true;
+                case Op::ADD_I:    e.movzx_eax_m8(vx); e.add_m16_ax(OFFSET_I); return true;
+                case Op::LD_FONT:  e.movzx_eax_m8(vx); e.lea_eax_rax_x5(); e.mov_m16_ax(OFFSET_I); return true;
+                case Op::LD_VX_DT: e.mov_al_m8(OFFSET_DT); e.mov_m8_al(vx); return true;
+                case Op::LD_DT:    e.mov_al_m8(vx); e.mov_m8_al(OFFSET_DT); return true;
+                case Op::LD_ST:    e.mov_al_m8(vx); e.mov_m8_al(OFFSET_ST); return true;
+                default:
+                    return false;
+            }
+        }
+    }
+
+
+    Jit::Jit(const Quirks& quirks)
+        : m_code_used(0), m_threshold(DEFAULT_THRESHOLD), m_quirks(quirks) {
+        void* code = mmap(
+            nullptr, CODE_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0
+        );
+        if(code == MAP_FAILED){
+            throw std::runtime_error("Could not map executable memory for the JIT");
+        }
+        m_code = static_cast<byte_t*>(code);
+        reset();
+    }
+
+    Jit::~Jit(){
+        munmap(m_code, CODE_SIZE);
+    }
+
+    void Jit::reset(){
+        m_code_used = 0;
+        m_blocks.clear();
+        m_entries.fill(COLD);
+        m_heat.fill(0);
+        m_coverage.fill(0);
+    }
+
+    const Jit::Block* Jit::lookup(const State& state, uint16_t pc){
+        if((pc & 0x1) || pc + 2 >= RAM_SIZE){
+            return nullptr;
+        }
+        int32_t& entry = m_entries[pc >> 1];
+        if(entry == COLD){
+            if(++m_heat[pc >> 1] < m_threshold){
+                return nullptr;
+            }
+            entry = compile(state, pc);
+        }
+        return entry >= 0 ? &m_blocks[entry] : nullptr;
+    }
+
+    void Jit::invalidate(uint16_t address, uint32_t size){
+        const uint32_t end = std::min<uint32_t>(uint32_t(address) + size, RAM_SIZE);
+        bool covered = false;
+        for(uint32_t i = address; i < end; ++i){
+            covered |= (m_coverage[i] != 0);
+        }
+
+        if(!covered){
+            // Only entries of unsupported instructions can be affected
+            for(uint32_t i = address & ~uint32_t(0x1); i < end; i += 2){
+                if(m_entries[i >> 1] == NO_BLOCK){
+                    m_entries[i >> 1] = COLD;
+                }
+            }
+            return;
+        }
+
+        // Blocks overlapping the write start at most one block length before it
+        const uint32_t window = 2 * MAX_BLOCK_LENGTH;
+        const uint32_t first  = address > window ? address - window : 0;
+        for(uint32_t i = first & ~uint32_t(0x1); i < end; i += 2){
+            int32_t& entry = m_entries[i >> 1];
+            if(entry == NO_BLOCK && i + 2 > address){
+                entry = COLD;
+            } else if(entry >= 0 && m_blocks[entry].end > address){
+                Block& block = m_blocks[entry];
+                for(uint32_t j = block.start; j != block.end; ++j){
+                    m_coverage[j]--;
+                }
+                block.fn = nullptr;
+                entry = COLD;
+                m_heat[i >> 1] = 0;
+            }
+        }
+    }
+
+    int32_t Jit::compile(const State& state, uint16_t pc){
+        if(m_code_used + MAX_BLOCK_BYTES > CODE_SIZE){
+            // Out of space: start over with an empty buffer
+            reset();
+        }
+
+        byte_t* start = m_code + m_code_used;
+        Emitter e(start);
+        uint16_t addr   = pc;
+        uint16_t length = 0;
+        bool ended      = false;
+
+        while(!ended && length != MAX_BLOCK_LENGTH && addr + 2 < RAM_SIZE){
+            const Instruction ins = decode((state.ram[addr] << 8) | state.ram[addr + 1]);
+            const uint16_t next = addr + 2;
+
+            if(ins.op == Op::JP){
+                e.mov_m16_imm(OFFSET_PC, ins.nnn);
+                e.ret();
+                ended = true;
+            } else if(ins.op == Op::SE_BYTE || ins.op == Op::SNE_BYTE
+                   || ins.op == Op::SE_REG  || ins.op == Op::SNE_REG
+                   || ins.op == Op::SAVE_RANGE || ins.op == Op::LOAD_RANGE){
+                // Skipping past the end of RAM is an error left to the interpreter,
+                // as are XO-CHIP skips, whose length depends on the next instruction
+                if(next + 2 >= RAM_SIZE || m_quirks.xo_chip){
+                    break;
+                }
+                e.mov_m16_imm(OFFSET_PC, next);
+                if(ins.op == Op::SE_BYTE || ins.op == Op::SNE_BYTE){
+                    e.cmp_m8_imm(reg_offset(ins.x), ins.kk);
+                } else {
+                    e.mov_al_m8(reg_offset(ins.y));
+                    e.cmp_al_m8(reg_offset(ins.x));
+                }
+                bool skip_if_equal = (ins.op != Op::SNE_BYTE && ins.op != Op::SNE_REG);
+                byte_t* no_skip = skip_if_equal ? e.jne() : e.je();
+                e.mov_m16_imm(OFFSET_PC, next + 2);
+                e.land(no_skip);
+                e.ret();
+                ended = true;
+            } else if(!emit_straight(e, ins, m_quirks)){
+                break;
+            }
+            addr = next;
+            ++length;
+        }
+
+        if(length == 0){
+            return NO_BLOCK;
+        }
+        if(!ended){
+            e.mov_m16_imm(OFFSET_PC, addr);
+            e.ret();
+        }
+        m_code_used += e.position() - start;
+
+        for(uint32_t i = pc; i != addr; ++i){
+            m_coverage[i]++;
+        }
+        m_blocks.push_back({reinterpret_cast<BlockFn>(start), pc, addr, length});
+        return int32_t(m_blocks.size() - 1);
+    }
+}
+
+#endif /* CHIP8_JIT */
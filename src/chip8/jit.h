@@ -0,0 +1,86 @@
+#ifndef CHIP8_JIT_H
+#define CHIP8_JIT_H
+
+#include <array>
+#include <vector>
+#include <cstdint>
+#include "state.h"
+#include "quirks.h"
+
+namespace CHIP8 {
+
+    /*
+    Dynamic recompiler of CHIP8 basic blocks into x86-64 machine code.
+    Only available on Linux x86-64 builds with CHIP8_ENABLE_JIT.
+
+    A block is a run of register, timer and I instructions, optionally
+    ended by a jump or a skip, compiled into a function that operates on
+    `State` directly and leaves the program counter after the block.
+    Anything else (calls, returns, drawing, RAM and keypad access, random numbers)
+    ends the block and is left to the interpreter.
+    Blocks are compiled once the address they start at has been reached
+    `threshold` times, and are discarded when the RAM they were read from is written.
+    */
+    class Jit {
+
+    public:
+        typedef void (*BlockFn)(State* state);
+
+        struct Block {
+            BlockFn  fn;
+            uint16_t start;  // Address of first instruction
+            uint16_t end;    // Address after the last byte read
+            uint16_t length; // Number of CHIP8 instructions executed
+        };
+
+        static constexpr std::size_t CODE_SIZE       = 4 << 20; // Bytes of machine code
+        static constexpr uint16_t    MAX_BLOCK_LENGTH = 64;      // Instructions
+        static constexpr uint16_t    DEFAULT_THRESHOLD = 8;
+
+    private:
+        // Block state per even address
+        static constexpr int32_t COLD     = -1; // Not compiled yet
+        static constexpr int32_t NO_BLOCK = -2; // First instruction not supported
+
+        byte_t*     m_code;
+        std::size_t m_code_used;
+        std::vector<Block> m_blocks;
+        std::array<int32_t,  RAM_SIZE / 2> m_entries;  // Block index or state
+        std::array<uint16_t, RAM_SIZE / 2> m_heat;     // Visits while cold
+        std::array<uint16_t, RAM_SIZE>     m_coverage; // Blocks reading each byte
+        uint16_t m_threshold;
+        Quirks   m_quirks;
+
+        /* Compiles the block starting at `pc`. Returns its index or NO_BLOCK. */
+        int32_t compile(const State& state, uint16_t pc);
+
+    public:
+        /* Maps memory for machine code, which will follow `quirks`.
+        Throws if it cannot be made executable. */
+        explicit Jit(const Quirks& quirks);
+        ~Jit();
+
+        Jit(const Jit&) = delete;
+        Jit& operator=(const Jit&) = delete;
+
+        /* Returns the block starting at `pc`, compiling it if it became hot.
+        Returns nullptr if the interpreter must run the instruction at `pc`. */
+        const Block* lookup(const State& state, uint16_t pc);
+
+        /* Discards blocks that read any of `size` bytes of RAM from `address` */
+        void invalidate(uint16_t address, uint32_t size);
+
+        /* Discards all blocks and frees the machine code buffer */
+        void reset();
+
+        /* Sets how many visits an address needs before its block is compiled */
+        void set_threshold(uint16_t threshold) { m_threshold = threshold; }
+
+        /* Discards all blocks and compiles new ones with `quirks` */
+        void set_quirks(const Quirks& quirks) { m_quirks = quirks; reset(); }
+
+    };
+}
+
+
+#endif /* CHIP8_JIT_H */
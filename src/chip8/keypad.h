@@ -0,0 +1,47 @@
+#ifndef CHIP8_KEYPAD_H
+#define CHIP8_KEYPAD_H
+
+#include <atomic>
+#include <cstdint>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /*
+    The 16-key keypad as one mask, bit k set while key k is held.
+    It is written as input arrives, e.g. from window events, and read by the
+    interpreter without locking, so the two may be on different threads.
+    Keys are independent of any other memory, so relaxed ordering is enough.
+    */
+    class Keypad {
+        std::atomic<uint16_t> m_keys;
+
+    public:
+        Keypad() : m_keys(0) { }
+
+        /* Returns true if a key is being pressed */
+        bool is_pressed(byte_t key) const {
+            return (m_keys.load(std::memory_order_relaxed) >> (key & 0xF)) & 0x1;
+        }
+
+        /* Returns the mask of the keys being pressed */
+        uint16_t get_keys() const { return m_keys.load(std::memory_order_relaxed); }
+
+        /* Replaces the keys being pressed */
+        void set_keys(uint16_t keys) { m_keys.store(keys, std::memory_order_relaxed); }
+
+        /* Presses or releases a key */
+        void set_key(byte_t key, bool pressed){
+            const uint16_t bit = uint16_t(1u << (key & 0xF));
+            if(pressed){
+                m_keys.fetch_or(bit, std::memory_order_relaxed);
+            } else {
+                m_keys.fetch_and(uint16_t(~bit), std::memory_order_relaxed);
+            }
+        }
+    };
+
+}
+
+
+#endif /* CHIP8_KEYPAD_H */
@@ -0,0 +1,67 @@
+#include "mapped_file.h"
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define CHIP8_MAPPED_FILE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace CHIP8 {
+
+    MappedFile::MappedFile(const std::string& filename)
+        : m_data(nullptr), m_size(0), m_mapped_size(0) {
+
+#if defined(CHIP8_MAPPED_FILE_MMAP)
+        int fd = open(filename.c_str(), O_RDONLY);
+        if(fd < 0){
+            throw std::runtime_error("Input file not found");
+        }
+        struct stat info;
+        if(fstat(fd, &info) != 0){
+            close(fd);
+            throw std::runtime_error("Could not read input file");
+        }
+        const std::size_t size = std::size_t(info.st_size);
+        if(size != 0){
+            void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data != MAP_FAILED){
+                m_data = static_cast<const byte_t*>(data);
+                m_size = size;
+                m_mapped_size = size;
+            }
+        }
+        close(fd);
+#endif
+
+        if(m_data == nullptr){
+            // Read the whole file instead
+            std::ifstream input(filename, std::ios::binary);
+            if(!input){
+                throw std::runtime_error("Input file not found");
+            }
+            m_buffer.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+            m_data = m_buffer.data();
+            m_size = m_buffer.size();
+        }
+    }
+
+    MappedFile::~MappedFile(){
+        release();
+    }
+
+    void MappedFile::release(){
+#if defined(CHIP8_MAPPED_FILE_MMAP)
+        if(m_mapped_size != 0){
+            munmap(const_cast<byte_t*>(m_data), m_mapped_size);
+            m_mapped_size = 0;
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef CHIP8_MAPPED_FILE_H
+#define CHIP8_MAPPED_FILE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /*
+    Read-only view of a whole file, memory-mapped where the platform allows it
+    so that ROMs and snapshots are read straight from the page cache.
+    Elsewhere, and for empty files, the contents are read into a buffer instead.
+    */
+    class MappedFile {
+        const byte_t*       m_data;
+        std::size_t         m_size;
+        std::size_t         m_mapped_size; // Zero if read into memory instead
+        std::vector<byte_t> m_buffer;
+
+        /* Unmaps the file */
+        void release();
+
+    public:
+        /* Opens a file. Throws if it is missing or cannot be read. */
+        explicit MappedFile(const std::string& filename);
+        ~MappedFile();
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /* First byte of the file */
+        const byte_t* data() const { return m_data; }
+
+        /* Bytes in the file */
+        std::size_t size() const { return m_size; }
+    };
+
+}
+
+
+#endif /* CHIP8_MAPPED_FILE_H */
@@ -0,0 +1,85 @@
+#include "movie.h"
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    uint64_t hash_rom(const std::vector<byte_t>& rom){
+        return hash_rom(rom.data(), rom.size());
+    }
+
+    uint64_t hash_rom(const byte_t* rom, std::size_t size){
+        return hash_bytes(rom, size);
+    }
+
+    void write_movie(std::ostream& output, const Movie& movie){
+        output << "chip8-movie " << Movie::VERSION << "\n"
+            << "rom " << std::hex << std::setfill('0') << std::setw(16) << movie.rom_hash << std::dec << "\n"
+            << "seed " << movie.seed << "\n"
+            << "profile " << profile_name(movie.profile) << "\n"
+            << "clock " << std::setprecision(17) << movie.clock_speed << "\n"
+            << "timing " << timing_name(movie.timing) << "\n"
+            << "frames " << movie.keys.size() << "\n";
+
+        // Input script of the frames where the keypad changes
+        for(std::size_t frame = 0; frame != movie.keys.size(); ++frame){
+            if(frame == 0 || movie.keys[frame] != movie.keys[frame - 1]){
+                output << frame << " " << std::hex << std::setw(4) << movie.keys[frame] << std::dec << "\n";
+            }
+        }
+    }
+
+    Movie read_movie(std::istream& input){
+        // Each header line starts with the name of its field
+        auto expect = [&](const char* name){
+            std::string field;
+            if(!(input >> field) || field != name){
+                throw std::runtime_error(std::string("Movie header is missing ") + name);
+            }
+        };
+
+        Movie movie;
+        int version = 0;
+        expect("chip8-movie");
+        if(!(input >> version) || version < 1 || version > Movie::VERSION){
+            throw std::runtime_error("Movie was written by an incompatible version");
+        }
+
+        std::string profile;
+        std::string timing = "uniform";
+        uint64_t frames;
+        expect("rom");
+        input >> std::hex >> movie.rom_hash >> std::dec;
+        expect("seed");
+        input >> movie.seed;
+        expect("profile");
+        input >> profile;
+        expect("clock");
+        input >> movie.clock_speed;
+        if(version >= 2){
+            expect("timing");
+            input >> timing;
+        }
+        expect("frames");
+        if(!(input >> frames)){
+            throw std::runtime_error("Invalid movie header");
+        }
+        movie.profile = parse_profile(profile);
+        movie.timing = parse_timing(timing);
+        movie.keys = parse_key_script(input, frames);
+        return movie;
+    }
+
+    Job movie_job(const Movie& movie, const std::string& rom){
+        Job job;
+        job.rom = rom;
+        job.frames = movie.keys.size();
+        job.seed = movie.seed;
+        job.keys = movie.keys;
+        job.profile = movie.profile;
+        job.clock_speed = movie.clock_speed;
+        job.timing = movie.timing;
+        return job;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef CHIP8_MOVIE_H
+#define CHIP8_MOVIE_H
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "chip8.h"
+#include "runner.h"
+#include "quirks.h"
+
+namespace CHIP8 {
+
+    /*
+    Input recorded from a session, enough to replay it bit-exactly:
+    the ROM it was played on, the random seed, the settings, and the
+    keypad at each frame. Sessions must run at a fixed clock speed,
+    so that every frame executes the same instructions on replay.
+    */
+    struct Movie {
+        static constexpr int VERSION = 2; // Version 1 had no timing
+
+        uint64_t rom_hash; // FNV-1a of the ROM, see `hash_rom`
+        uint32_t seed;
+        Profile profile = Profile::DEFAULT;
+        double clock_speed = Interpreter::DEFAULT_CLOCK_SPEED; // Hz
+        Timing timing = Timing::UNIFORM;
+        KeyTrace keys; // Keypad at each frame
+    };
+
+    /* Returns the FNV-1a hash of a ROM */
+    uint64_t hash_rom(const std::vector<byte_t>& rom);
+
+    /* Returns the FNV-1a hash of a ROM of `size` bytes */
+    uint64_t hash_rom(const byte_t* rom, std::size_t size);
+
+    /*
+    Writes a movie as text: a header of `<field> <value>` lines followed
+    by an input script with a line at each frame the keypad changes.
+    */
+    void write_movie(std::ostream& output, const Movie& movie);
+
+    /* Reads a movie written by `write_movie`. Throws if it is malformed. */
+    Movie read_movie(std::istream& input);
+
+    /* Returns a job that replays `movie` headless on the ROM at `rom` */
+    Job movie_job(const Movie& movie, const std::string& rom);
+
+}
+
+
+#endif /* CHIP8_MOVIE_H */
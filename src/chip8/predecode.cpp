@@ -0,0 +1,98 @@
+#include "predecode.h"
+#include "runner.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <utility>
+
+namespace CHIP8 {
+
+    PredecodeHeader PredecodeHeader::current(){
+        return PredecodeHeader{
+            {'C', '8', 'P', 'D'}, Predecode::VERSION, 0x0102, uint32_t(sizeof(Predecode)), uint16_t(Op::COUNT), 0
+        };
+    }
+
+    bool PredecodeHeader::is_compatible() const {
+        const PredecodeHeader expected = current();
+        return std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+            && version == expected.version
+            && byte_order == expected.byte_order
+            && size == expected.size
+            && op_count == expected.op_count;
+    }
+
+    Predecode predecode(const byte_t* rom, std::size_t size){
+        Predecode result{}; // Zeroes the padding written to disk too
+        result.header = PredecodeHeader::current();
+        result.rom_hash = hash_bytes(rom, size);
+        result.rom_size = uint32_t(size);
+
+        // Only the part of the ROM in RAM is decoded, as the interpreter caches no more
+        const std::size_t low = std::min<std::size_t>(size, RAM_SIZE - RAM_PROG_OFFSET);
+        for(Instruction& ins : result.decoded){
+            ins.op = Op::UNDECODED;
+        }
+        for(std::size_t i = 0; i + 1 < low; i += 2){
+            result.decoded[(RAM_PROG_OFFSET + i) >> 1] = decode((rom[i] << 8) | rom[i + 1]);
+        }
+        return result;
+    }
+
+    PredecodeCache::PredecodeCache(std::string directory)
+        : m_directory(std::move(directory)) {}
+
+    std::string PredecodeCache::path(uint64_t rom_hash) const {
+        char name[40];
+        std::snprintf(name, sizeof(name), "%016llx.c8pd", static_cast<unsigned long long>(rom_hash));
+        return m_directory + "/" + name;
+    }
+
+    bool Predecode::is_valid() const {
+        if(!header.is_compatible()){
+            return false;
+        }
+        for(const Instruction& ins : decoded){
+            if(ins.op >= Op::COUNT){
+                return false;
+            }
+        }
+        return true;
+    }
+
+    Predecode PredecodeCache::get(const byte_t* rom, std::size_t size, bool* hit) const {
+        const uint64_t rom_hash = hash_bytes(rom, size);
+        const std::string filename = path(rom_hash);
+
+        Predecode cached;
+        std::ifstream input(filename, std::ios::binary);
+        if(input.read(reinterpret_cast<char*>(&cached), sizeof(Predecode))
+            && cached.is_valid()
+            && cached.rom_hash == rom_hash
+            && cached.rom_size == size){
+            if(hit){
+                *hit = true;
+            }
+            return cached;
+        }
+        input.close();
+
+        const Predecode result = predecode(rom, size);
+        if(hit){
+            *hit = false;
+        }
+
+        // Written aside and renamed, so that other processes never read half a file
+        const std::string partial = filename + ".tmp";
+        std::ofstream output(partial, std::ios::binary | std::ios::trunc);
+        if(output.write(reinterpret_cast<const char*>(&result), sizeof(Predecode))){
+            output.close();
+            std::rename(partial.c_str(), filename.c_str());
+        } else {
+            output.close();
+            std::remove(partial.c_str());
+        }
+        return result;
+    }
+}
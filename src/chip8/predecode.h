@@ -0,0 +1,80 @@
+#ifndef CHIP8_PREDECODE_H
+#define CHIP8_PREDECODE_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "state.h"
+#include "instruction.h"
+
+namespace CHIP8 {
+
+    /* Identifies a cached analysis and the build layout it was written with */
+    struct PredecodeHeader {
+        char     magic[4];   // "C8PD"
+        uint16_t version;
+        uint16_t byte_order; // 0x0102 as written by the host
+        uint32_t size;       // Bytes in the whole analysis
+        uint16_t op_count;   // Op::COUNT, as operations are stored by number
+        uint16_t reserved;
+
+        /* Returns the header of analyses written by this build */
+        static PredecodeHeader current();
+
+        /* Returns true if an analysis with this header can be read by this build */
+        bool is_compatible() const;
+    };
+
+    /*
+    What can be worked out about a ROM before running it, about 20 KB: its instructions decoded.
+    Decoding does not depend on the quirk profile, which only changes how instructions execute,
+    so one analysis serves every profile.
+    Like `Snapshot`, it is a plain structure that is written to disk as is.
+    */
+    struct Predecode {
+        // Version 1 did not record the operations, version 2 held a profile and the reachable code.
+        // Bump when they change.
+        static constexpr uint16_t VERSION = 3;
+
+        PredecodeHeader header;
+        uint64_t rom_hash;  // `hash_bytes` of the ROM
+        uint32_t rom_size;  // Bytes of the ROM, which is loaded at RAM_PROG_OFFSET
+        uint32_t reserved;  // Keeps the layout free of padding
+        std::array<Instruction, RAM_SIZE / 2> decoded; // Instruction at each even address of the ROM, UNDECODED elsewhere
+
+        /* Returns true if the header is compatible and every operation is in range,
+        as analyses read from disk may have been written by another build or damaged */
+        bool is_valid() const;
+    };
+    static_assert(std::is_trivially_copyable<Predecode>::value, "Analyses are copied as bytes");
+
+    /* Decodes a ROM */
+    Predecode predecode(const byte_t* rom, std::size_t size);
+
+    /*
+    Directory of analyses, one file per ROM named after its hash,
+    so that a ROM is analysed once rather than every time it is run.
+    */
+    class PredecodeCache {
+        std::string m_directory;
+
+    public:
+        /* Uses an existing directory */
+        explicit PredecodeCache(std::string directory);
+
+        /* Returns the file the analysis of a ROM is cached in */
+        std::string path(uint64_t rom_hash) const;
+
+        /*
+        Returns the analysis of a ROM, read from the cache if it holds one
+        for the same contents, otherwise analysed and added to it.
+        Sets `hit` to whether it was read. Failing to write the cache is not an error.
+        */
+        Predecode get(const byte_t* rom, std::size_t size, bool* hit = nullptr) const;
+    };
+
+}
+
+
+#endif /* CHIP8_PREDECODE_H */
@@ -0,0 +1,219 @@
+#include "profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <vector>
+
+namespace CHIP8 {
+
+    namespace {
+
+        constexpr std::size_t REPORT_ROWS = 10;
+
+        /* Formats an address as 0xNNN */
+        struct Hex {
+            uint16_t value;
+        };
+
+        std::ostream& operator<<(std::ostream& output, Hex hex){
+            return output << "0x" << std::hex << std::uppercase << std::setfill('0') << std::setw(3)
+                << hex.value << std::dec << std::nouppercase << std::setfill(' ');
+        }
+
+        double percent(uint64_t part, uint64_t total){
+            return (total != 0) ? 100.0 * part / total : 0.0;
+        }
+
+        /* Addresses [start, end) and counts over them */
+        struct Range {
+            uint16_t start;
+            uint16_t end;
+            uint64_t count;
+            uint64_t other; // Second count, e.g. writes next to reads
+        };
+
+        /* Sorts ranges by decreasing count and other count together and keeps the first few */
+        void keep_top(std::vector<Range>& rows){
+            std::stable_sort(rows.begin(), rows.end(), [](const Range& a, const Range& b){
+                return a.count + a.other > b.count + b.other;
+            });
+            if(rows.size() > REPORT_ROWS){
+                rows.resize(REPORT_ROWS);
+            }
+        }
+    }
+
+    void Profiler::clear(){
+        m_ops.fill(0);
+        m_executed.fill(0);
+        m_reads.fill(0);
+        m_writes.fill(0);
+        m_code_writes.fill(0);
+        m_calls.fill(0);
+        m_back_jumps.fill(0);
+        m_back_jump_targets.fill(0);
+        m_seconds.fill(0.0);
+        m_instructions = 0;
+    }
+
+    void Profiler::count_reads(uint16_t address, uint16_t size){
+        for(uint32_t addr = address; addr < uint32_t(address) + size && addr < RAM_SIZE; ++addr){
+            m_reads[addr]++;
+        }
+    }
+
+    void Profiler::count_writes(uint16_t address, uint16_t size){
+        for(uint32_t addr = address; addr < uint32_t(address) + size && addr < RAM_SIZE; ++addr){
+            m_writes[addr]++;
+            // The byte belongs to an instruction starting on it or the byte before
+            if(m_executed[addr] != 0 || (addr != 0 && m_executed[addr - 1] != 0)){
+                m_code_writes[addr]++;
+            }
+        }
+    }
+
+    void Profiler::record(uint16_t pc, const Instruction& ins, const State& state){
+        m_instructions++;
+        m_ops[std::size_t(ins.op)]++;
+        m_executed[pc]++;
+
+        switch(ins.op){
+            case Op::CALL:
+                m_calls[ins.nnn]++;
+                break;
+            case Op::JP:
+                if(ins.nnn <= pc){
+                    m_back_jumps[pc]++;
+                    m_back_jump_targets[pc] = ins.nnn;
+                }
+                break;
+            case Op::DRW:      count_reads(state.Ireg, ins.n);       break;
+            case Op::LD_LOAD:  count_reads(state.Ireg, ins.x + 1);   break;
+            case Op::LD_BCD:   count_writes(state.Ireg, 3);          break;
+            case Op::LD_STORE: count_writes(state.Ireg, ins.x + 1);  break;
+            default: break;
+        }
+    }
+
+    void Profiler::write_report(std::ostream& output) const {
+        const uint64_t total = m_instructions;
+        output << std::fixed << std::setprecision(1);
+        output << "Instructions: " << total << "\n";
+
+        double seconds = 0.0;
+        for(double phase : m_seconds){
+            seconds += phase;
+        }
+        if(seconds > 0.0){
+            static const char* const PHASES[] = {"emulation", "hand-off", "idle", "present and input", "idle"};
+            static_assert(sizeof(PHASES) / sizeof(PHASES[0]) == std::size_t(Phase::COUNT), "One name is required per phase");
+
+            // The two threads run side by side, so each is reported as a share of its own time
+            const std::size_t present = std::size_t(Phase::PRESENT_INPUT);
+            const struct { const char* title; std::size_t first, last; } threads[] = {
+                {"Time, running the program:", 0, present},
+                {"Time, presenting:", present, m_seconds.size()},
+            };
+            for(const auto& thread : threads){
+                double total = 0.0;
+                for(std::size_t i = thread.first; i != thread.last; ++i){
+                    total += m_seconds[i];
+                }
+                if(total <= 0.0){
+                    continue;
+                }
+                output << "\n" << thread.title << "\n";
+                for(std::size_t i = thread.first; i != thread.last; ++i){
+                    output << "  " << std::left << std::setw(20) << PHASES[i] << std::right
+                        << std::setprecision(3) << std::setw(10) << m_seconds[i] << " s"
+                        << std::setprecision(1) << std::setw(7) << 100.0 * m_seconds[i] / total << "%\n";
+                }
+            }
+        }
+
+        // Operations, most frequent first
+        std::vector<std::pair<uint64_t, Op>> ops;
+        for(std::size_t i = 0; i != m_ops.size(); ++i){
+            if(m_ops[i] != 0){
+                ops.push_back({m_ops[i], Op(i)});
+            }
+        }
+        std::stable_sort(ops.begin(), ops.end(), [](const auto& a, const auto& b){ return a.first > b.first; });
+        output << "\nOperations:\n";
+        for(const auto& op : ops){
+            output << "  " << std::left << std::setw(10) << op_name(op.second) << std::right
+                << std::setw(14) << op.first << std::setw(7) << percent(op.first, total) << "%\n";
+        }
+
+        // Loops: from the target of a backward jump to the jump itself
+        std::vector<Range> loops;
+        for(uint32_t pc = 0; pc != RAM_SIZE; ++pc){
+            if(m_back_jumps[pc] == 0){
+                continue;
+            }
+            const uint16_t start = m_back_jump_targets[pc];
+            uint64_t executed = 0;
+            for(uint32_t addr = start; addr <= pc; ++addr){
+                executed += m_executed[addr];
+            }
+            loops.push_back({start, uint16_t(pc + 2), executed, 0});
+        }
+        keep_top(loops);
+        output << "\nHottest loops:\n";
+        for(const Range& loop : loops){
+            output << "  " << Hex{loop.start} << "-" << Hex{uint16_t(loop.end - 1)}
+                << std::setw(14) << loop.count << " instructions" << std::setw(7) << percent(loop.count, total) << "%"
+                << std::setw(12) << m_back_jumps[loop.end - 2] << " iterations\n";
+        }
+
+        // Subroutines by number of calls
+        std::vector<Range> calls;
+        for(uint32_t addr = 0; addr != RAM_SIZE; ++addr){
+            if(m_calls[addr] != 0){
+                calls.push_back({uint16_t(addr), uint16_t(addr), m_calls[addr], 0});
+            }
+        }
+        keep_top(calls);
+        output << "\nHottest subroutines:\n";
+        for(const Range& call : calls){
+            output << "  " << Hex{call.start} << std::setw(14) << call.count << " calls\n";
+        }
+
+        // Runs of consecutive addresses accessed as data or modified after running
+        auto ranges = [](const std::array<uint64_t, RAM_SIZE>& counts, const std::array<uint64_t, RAM_SIZE>& other){
+            std::vector<Range> found;
+            for(uint32_t addr = 0; addr != RAM_SIZE; ++addr){
+                if(counts[addr] == 0 && other[addr] == 0){
+                    continue;
+                }
+                if(!found.empty() && found.back().end == addr){
+                    found.back().end++;
+                } else {
+                    found.push_back({uint16_t(addr), uint16_t(addr + 1), 0, 0});
+                }
+                found.back().count += counts[addr];
+                found.back().other += other[addr];
+            }
+            return found;
+        };
+
+        std::vector<Range> data = ranges(m_reads, m_writes);
+        keep_top(data);
+        output << "\nMost accessed data:\n";
+        for(const Range& range : data){
+            output << "  " << Hex{range.start} << "-" << Hex{uint16_t(range.end - 1)}
+                << std::setw(14) << range.count << " reads" << std::setw(14) << range.other << " writes\n";
+        }
+
+        const std::array<uint64_t, RAM_SIZE> none{};
+        std::vector<Range> modified = ranges(m_code_writes, none);
+        output << "\nSelf-modified code:\n";
+        if(modified.empty()){
+            output << "  none\n";
+        }
+        for(const Range& range : modified){
+            output << "  " << Hex{range.start} << "-" << Hex{uint16_t(range.end - 1)}
+                << std::setw(14) << range.count << " writes\n";
+        }
+        output << std::defaultfloat << std::flush;
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef CHIP8_PROFILER_H
+#define CHIP8_PROFILER_H
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include "state.h"
+#include "instruction.h"
+
+namespace CHIP8 {
+
+    /* Parts of the main loop time is attributed to, on the thread running the program and on the one presenting it */
+    enum class Phase {
+        EMULATION,     // Running the instructions of a frame
+        HANDOFF,       // Copying the display for the presenting thread
+        IDLE,          // Waiting for the next frame
+        PRESENT_INPUT, // Presenting the display and polling input, one renderer update
+        PRESENT_IDLE,  // Waiting for a new frame to present
+        COUNT
+    };
+
+    /*
+    Execution profile of a program: how often each operation, address and
+    jump ran, and how RAM was read and written.
+    The interpreter only records into a profiler when built with
+    CHIP8_ENABLE_PROFILER, otherwise the counters are compiled out.
+    */
+    class Profiler {
+        std::array<uint64_t, std::size_t(Op::COUNT)> m_ops;
+        std::array<uint64_t, RAM_SIZE> m_executed;   // Instructions run at each address
+        std::array<uint64_t, RAM_SIZE> m_reads;      // Data reads, e.g. sprites and Fx65
+        std::array<uint64_t, RAM_SIZE> m_writes;     // Fx33 and Fx55 writes
+        std::array<uint64_t, RAM_SIZE> m_code_writes; // Writes to bytes already run as code
+        std::array<uint64_t, RAM_SIZE> m_calls;      // Calls to each subroutine
+        std::array<uint64_t, RAM_SIZE> m_back_jumps; // Backward jumps taken from each address
+        std::array<uint16_t, RAM_SIZE> m_back_jump_targets; // Where the last one went
+        std::array<double, std::size_t(Phase::COUNT)> m_seconds;
+        uint64_t m_instructions;
+
+        /* Counts a read or write of `size` bytes from `address` */
+        void count_reads(uint16_t address, uint16_t size);
+        void count_writes(uint16_t address, uint16_t size);
+
+    public:
+        Profiler() { clear(); }
+
+        /* Resets all counters */
+        void clear();
+
+        /* Counts `ins`, at `pc`, about to be executed on `state` */
+        void record(uint16_t pc, const Instruction& ins, const State& state);
+
+        /* Attributes time spent in the main loop */
+        void add_time(Phase phase, double seconds) { m_seconds[std::size_t(phase)] += seconds; }
+
+        /* Number of instructions recorded */
+        uint64_t get_instructions() const { return m_instructions; }
+
+        /* Number of times an operation was executed */
+        uint64_t get_op_count(Op op) const { return m_ops[std::size_t(op)]; }
+
+        /* Number of instructions executed at an address */
+        uint64_t get_executed(uint16_t address) const { return m_executed[address]; }
+
+        /* Number of data reads of a RAM address */
+        uint64_t get_reads(uint16_t address) const { return m_reads[address]; }
+
+        /* Number of writes to a RAM address */
+        uint64_t get_writes(uint16_t address) const { return m_writes[address]; }
+
+        /* Number of writes to a RAM address after it was executed */
+        uint64_t get_code_writes(uint16_t address) const { return m_code_writes[address]; }
+
+        /* Number of calls to a subroutine */
+        uint64_t get_calls(uint16_t address) const { return m_calls[address]; }
+
+        /* Seconds attributed to a phase of the main loop */
+        double get_time(Phase phase) const { return m_seconds[std::size_t(phase)]; }
+
+        /*
+        Writes a text report: time per phase, operations by count, hottest loops
+        (ranges closed by a backward jump), hottest subroutines, most accessed
+        data and the code that was modified after it ran.
+        */
+        void write_report(std::ostream& output) const;
+    };
+
+}
+
+
+#endif /* CHIP8_PROFILER_H */
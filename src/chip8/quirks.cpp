@@ -0,0 +1,36 @@
+#include "quirks.h"
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    const Quirks& get_quirks(Profile profile){
+        switch(profile){
+            case Profile::COSMAC_VIP: return CosmacVipQuirks::value;
+            case Profile::CHIP48:     return Chip48Quirks::value;
+            case Profile::SCHIP:      return SchipQuirks::value;
+            case Profile::XO_CHIP:    return XoChipQuirks::value;
+            case Profile::DEFAULT:    break;
+        }
+        return DefaultQuirks::value;
+    }
+
+    const char* profile_name(Profile profile){
+        switch(profile){
+            case Profile::COSMAC_VIP: return "vip";
+            case Profile::CHIP48:     return "chip48";
+            case Profile::SCHIP:      return "schip";
+            case Profile::XO_CHIP:    return "xochip";
+            case Profile::DEFAULT:    break;
+        }
+        return "default";
+    }
+
+    Profile parse_profile(const std::string& name){
+        for(Profile profile : {Profile::DEFAULT, Profile::COSMAC_VIP, Profile::CHIP48, Profile::SCHIP, Profile::XO_CHIP}){
+            if(name == profile_name(profile)){
+                return profile;
+            }
+        }
+        throw std::runtime_error("Unknown quirk profile: " + name);
+    }
+}
@@ -0,0 +1,78 @@
+#ifndef CHIP8_QUIRKS_H
+#define CHIP8_QUIRKS_H
+
+#include <string>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /* How FX55 and FX65 leave the I register after accessing memory */
+    enum class MemoryIncrement : byte_t {
+        NONE,       // I is unchanged
+        X,          // I += X
+        X_PLUS_ONE, // I += X + 1, pointing after the last register
+    };
+
+    /* Behaviours that differ between CHIP8 implementations */
+    struct Quirks {
+        bool shift_uses_vy;   // 8XY6/8XYE shift VY into VX instead of shifting VX in place
+        MemoryIncrement memory_increment; // Effect of FX55/FX65 on I
+        bool jump_uses_vx;    // BXNN jumps to XNN + VX instead of NNN + V0
+        bool logic_resets_vf; // 8XY1/8XY2/8XY3 set VF to zero
+        bool super_chip;      // SUPER-CHIP instructions: high resolution, scrolling, DXY0, FX30, FX75 and FX85
+        bool xo_chip;         // XO-CHIP: 64 KB of memory, two bitplanes, F000 NNNN, 5XY2/5XY3, FN01, F002 and FX3A
+    };
+
+    /*
+    Quirk policies for the execution core. Each one is a type so that
+    handlers are instantiated per profile and resolve quirks at compile time.
+    */
+
+    // Behaviour of this interpreter before profiles existed
+    struct DefaultQuirks {
+        static constexpr Quirks value = {false, MemoryIncrement::NONE, false, false, false, false};
+    };
+
+    // RCA COSMAC VIP, the original interpreter
+    struct CosmacVipQuirks {
+        static constexpr Quirks value = {true, MemoryIncrement::X_PLUS_ONE, false, true, false, false};
+    };
+
+    // CHIP-48 on the HP-48 calculators
+    struct Chip48Quirks {
+        static constexpr Quirks value = {false, MemoryIncrement::X, true, false, false, false};
+    };
+
+    // SUPER-CHIP 1.1
+    struct SchipQuirks {
+        static constexpr Quirks value = {false, MemoryIncrement::NONE, true, false, true, false};
+    };
+
+    // XO-CHIP
+    struct XoChipQuirks {
+        static constexpr Quirks value = {true, MemoryIncrement::X_PLUS_ONE, false, false, true, true};
+    };
+
+    /* Quirk profiles selectable at run time, one per policy */
+    enum class Profile : byte_t {
+        DEFAULT,
+        COSMAC_VIP,
+        CHIP48,
+        SCHIP,
+        XO_CHIP,
+    };
+
+    /* Returns the quirks of a profile */
+    const Quirks& get_quirks(Profile profile);
+
+    /* Returns the name of a profile, as accepted by `parse_profile` */
+    const char* profile_name(Profile profile);
+
+    /* Returns the profile named `name` (default, vip, chip48, schip, xochip).
+    Throws if the name is not recognised. */
+    Profile parse_profile(const std::string& name);
+
+}
+
+
+#endif /* CHIP8_QUIRKS_H */
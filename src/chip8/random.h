@@ -0,0 +1,34 @@
+#ifndef CHIP8_RANDOM_H
+#define CHIP8_RANDOM_H
+
+#include <cstdint>
+#include "state.h"
+
+namespace CHIP8 {
+
+    /*
+    Xorshift pseudo-random generator for the Cxkk instruction.
+    Its whole state is one word, so it can be copied along with the rest of
+    a virtual machine and gives the same sequence for the same seed everywhere.
+    */
+    struct Random {
+        uint32_t state;
+
+        /* Restarts the sequence. Zero is replaced as xorshift would only return zeros. */
+        void seed(uint32_t value){
+            state = (value != 0) ? value : 0x9E3779B9;
+        }
+
+        /* Returns the next random byte */
+        byte_t next_byte(){
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return byte_t(state >> 24);
+        }
+    };
+
+}
+
+
+#endif /* CHIP8_RANDOM_H */
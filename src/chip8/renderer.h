@@ -1,89 +1,58 @@
 #ifndef CHIP8_RENDERER_H
 #define CHIP8_RENDERER_H
 
-#include <SFML/Graphics.hpp>
 #include "state.h"
+#include "framebuffer.h"
+#include "keypad.h"
 
 namespace CHIP8 {
 
+    /*
+    Display and input backend used by the interpreter.
+    Implementations present the framebuffer of the virtual machine
+    and own the state of the 16-key keypad, which they update as input arrives.
+    */
     class Renderer {
-    
-    public:
-        static constexpr int NATIVE_WIDTH  = 64;
-        static constexpr int NATIVE_HEIGHT = 32;
-        static constexpr int SCREEN_SCALE  = 16;
-        static constexpr int SCREEN_WIDTH  = NATIVE_WIDTH  * SCREEN_SCALE;
-        static constexpr int SCREEN_HEIGHT = NATIVE_HEIGHT * SCREEN_SCALE;
 
-    private:
-        sf::Image   m_canvas;
-        sf::Texture m_texture;
-        sf::Sprite  m_sprite;
-        sf::Clock   m_clock;
-        std::unique_ptr<sf::RenderWindow> m_window;
-        std::pair<sf::Color, sf::Color>   m_theme;
-        bool m_running;
-        std::array<bool, 0x10> m_keypad;
-        const std::array<sf::Keyboard::Key, 0x10> m_key_bindings = {
-            sf::Keyboard::Key::Num0,
-            sf::Keyboard::Key::Num1,
-            sf::Keyboard::Key::Num2,
-            sf::Keyboard::Key::Num3,
-            sf::Keyboard::Key::Num4,
-            sf::Keyboard::Key::Num5,
-            sf::Keyboard::Key::Num6,
-            sf::Keyboard::Key::Num7,
-            sf::Keyboard::Key::Num8,
-            sf::Keyboard::Key::Num9,
-            sf::Keyboard::Key::A   ,
-            sf::Keyboard::Key::B   ,
-            sf::Keyboard::Key::C   ,
-            sf::Keyboard::Key::D   ,
-            sf::Keyboard::Key::E   ,
-            sf::Keyboard::Key::F   ,
-        };
+    protected:
+        Keypad m_keypad;
 
     public:
-        Renderer()
-            : m_running(false),
-              m_theme(sf::Color::Black, sf::Color::White){
-            m_keypad.fill(false);
-        }
-        
-        ~Renderer() { }
-
-        /* Creates a window */
-        void init();
-
-        /* True if the window is open */
-        bool is_running();
+        static constexpr int NATIVE_WIDTH  = Framebuffer::LORES_WIDTH;
+        static constexpr int NATIVE_HEIGHT = Framebuffer::LORES_HEIGHT;
+        static constexpr int SCREEN_SCALE  = 16; // Halved in high resolution
+        static constexpr int SCREEN_WIDTH  = NATIVE_WIDTH  * SCREEN_SCALE;
+        static constexpr int SCREEN_HEIGHT = NATIVE_HEIGHT * SCREEN_SCALE;
 
-        /* Polls events, updates canvas, and returns
-        frame time in milliseconds */
-        double update();
+        virtual ~Renderer() { }
 
-        /* Draws a byte onto the canvas using the bits as pixels.
-        Returns True if a pixel was overwritten. */
-        bool draw_byte(byte_t x, byte_t y, byte_t byte);
+        /* Prepares the backend for drawing */
+        virtual void init() = 0;
 
-        /* Draws (XORs) a single pixel onto the canvas at position (x,y).
-        Returns True if a pixel was overwritten. */
-        bool draw_pixel(uint8_t x, uint8_t y, bool pixel);
+        /* True if the backend has been initialised and not closed */
+        virtual bool is_running() = 0;
 
-        /* Fills out the canvas with black color */
-        void clear_canvas();
+        /* Polls events, presents the framebuffer, and returns
+        frame time in milliseconds.
+        The rows flagged as dirty in the framebuffer are the
+        ones that changed since the previous update. */
+        virtual double update(const Framebuffer& framebuffer) = 0;
 
-        /* Defines the two colors used on the canvas */
-        void set_theme(sf::Color bright, sf::Color dark);
+        /* Presents the two bitplanes of XO-CHIP, whose pixels select one of
+        four colors. By default, only the first plane is shown. */
+        virtual double update(const Framebuffer& first, const Framebuffer& /*second*/){
+            return update(first);
+        }
 
-        /* Query keypad for keys */
-        void process_input();
+        /* Retrieve the keys being pressed, read by the interpreter on each key instruction.
+        Like `is_rewind_pressed`, it may be read from another thread than the one updating. */
+        Keypad& get_keypad() { return m_keypad; }
 
-        /* Returns true if a keypad key is being pressed */
-        bool is_key_pressed(byte_t key);
+        /* Returns true while the user asks to step back in time. Must be safe to call from any thread. */
+        virtual bool is_rewind_pressed() { return false; }
 
     };
 }
 
 
-#endif /* CHIP8_RENDERER_H */
\ No newline at end of file
+#endif /* CHIP8_RENDERER_H */
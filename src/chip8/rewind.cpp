@@ -0,0 +1,120 @@
+#include "rewind.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    Rewind::Rewind(std::size_t frames, std::size_t keyframe_interval)
+        : m_interval(keyframe_interval), m_newest(0), m_used(0), m_frames(0), m_words(WORDS) {
+        if(frames == 0 || keyframe_interval == 0){
+            throw std::runtime_error("Rewind needs room for at least one frame");
+        }
+        // One more group than needed, as the oldest one is partly overwritten
+        m_groups.resize((frames + m_interval - 1) / m_interval + 1);
+    }
+
+    void Rewind::push(const Snapshot& snapshot){
+        Group* group = &m_groups[m_newest];
+        if(m_used == 0 || group->frames == m_interval){
+            // Start a new group, reusing the oldest one if all are taken
+            if(m_used != 0){
+                m_newest = (m_newest + 1) % m_groups.size();
+            }
+            group = &m_groups[m_newest];
+            if(m_used == m_groups.size()){
+                m_frames -= group->frames;
+            } else {
+                m_used++;
+            }
+            group->keyframe.resize(WORDS);
+            std::memcpy(group->keyframe.data(), &snapshot, sizeof(Snapshot));
+            group->deltas.clear();
+            group->offsets.clear();
+            group->frames = 1;
+            m_frames++;
+            return;
+        }
+
+        // Each run is a word with the number of unchanged words in the upper half
+        // and the number of changed words in the lower half, followed by their XORs
+        uint64_t* words = m_words.data();
+        std::memcpy(words, &snapshot, sizeof(Snapshot));
+        const uint64_t* key = group->keyframe.data();
+        group->offsets.push_back(uint32_t(group->deltas.size()));
+        std::size_t i = 0;
+        while(i != WORDS){
+            const std::size_t first = i;
+            while(i != WORDS && words[i] == key[i]){
+                ++i;
+            }
+            const std::size_t changed = i;
+            while(i != WORDS && words[i] != key[i]){
+                ++i;
+            }
+            if(changed == WORDS){
+                break; // Unchanged up to the end
+            }
+            group->deltas.push_back(uint64_t(changed - first) << 32 | (i - changed));
+            for(std::size_t j = changed; j != i; ++j){
+                group->deltas.push_back(words[j] ^ key[j]);
+            }
+        }
+        group->frames++;
+        m_frames++;
+    }
+
+    bool Rewind::pop(Snapshot& snapshot){
+        if(m_frames == 0){
+            return false;
+        }
+        Group& group = m_groups[m_newest];
+        uint64_t* words = m_words.data();
+        std::memcpy(words, group.keyframe.data(), WORDS * sizeof(uint64_t));
+
+        if(group.frames > 1){
+            const std::size_t start = group.offsets.back();
+            const uint64_t* run = group.deltas.data() + start;
+            const uint64_t* end = group.deltas.data() + group.deltas.size();
+            std::size_t i = 0;
+            while(run != end){
+                i += std::size_t(*run >> 32);
+                const std::size_t changed = std::size_t(*run & 0xFFFFFFFF);
+                ++run;
+                for(std::size_t j = 0; j != changed; ++j){
+                    words[i++] ^= *run++;
+                }
+            }
+            group.deltas.resize(start);
+            group.offsets.pop_back();
+            group.frames--;
+        } else {
+            // The keyframe was the last frame in its group
+            group.frames = 0;
+            m_used--;
+            m_newest = (m_newest + m_groups.size() - 1) % m_groups.size();
+        }
+        m_frames--;
+
+        std::memcpy(static_cast<void*>(&snapshot), words, sizeof(Snapshot)); // Trivially copyable, not trivial
+        return true;
+    }
+
+    void Rewind::clear(){
+        for(Group& group : m_groups){
+            group.frames = 0;
+        }
+        m_newest = 0;
+        m_used = 0;
+        m_frames = 0;
+    }
+
+    std::size_t Rewind::memory_usage() const {
+        std::size_t bytes = 0;
+        for(const Group& group : m_groups){
+            bytes += group.keyframe.capacity() * sizeof(uint64_t);
+            bytes += group.deltas.capacity() * sizeof(uint64_t);
+            bytes += group.offsets.capacity() * sizeof(uint32_t);
+        }
+        return bytes;
+    }
+}
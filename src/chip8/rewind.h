@@ -0,0 +1,64 @@
+#ifndef CHIP8_REWIND_H
+#define CHIP8_REWIND_H
+
+#include <cstdint>
+#include <vector>
+#include "snapshot.h"
+
+namespace CHIP8 {
+
+    /*
+    History of snapshots, one per frame, that can be stepped back through.
+    Every `keyframe_interval` frames a whole snapshot is kept as a keyframe, and
+    the frames after it are stored as the XOR with it, run-length encoded over
+    64-bit words. Most of the RAM and display stay the same between frames, so a
+    frame usually takes tens of bytes and minutes of history fit in a few MB.
+    The storage is a ring of groups of frames reused in place, so once it is full
+    recording allocates nothing and the oldest group is dropped.
+    */
+    class Rewind {
+        static constexpr std::size_t WORDS = sizeof(Snapshot) / sizeof(uint64_t);
+        static_assert(sizeof(Snapshot) % sizeof(uint64_t) == 0, "Snapshots are encoded as whole words");
+
+        /* A keyframe and the frames encoded against it */
+        struct Group {
+            std::vector<uint64_t> keyframe;
+            std::vector<uint64_t> deltas;  // Encoded frames after the keyframe
+            std::vector<uint32_t> offsets; // Start of each of them in `deltas`
+            std::size_t frames = 0;        // Including the keyframe
+        };
+
+        std::vector<Group> m_groups;
+        std::size_t m_interval;
+        std::size_t m_newest;   // Group frames are added to
+        std::size_t m_used;     // Groups holding frames
+        std::size_t m_frames;
+        std::vector<uint64_t> m_words; // Scratch for the snapshot being encoded
+
+    public:
+        static constexpr std::size_t DEFAULT_KEYFRAME_INTERVAL = 60;
+
+        /* Keeps at least the last `frames` frames */
+        explicit Rewind(std::size_t frames, std::size_t keyframe_interval = DEFAULT_KEYFRAME_INTERVAL);
+
+        /* Records a frame, dropping the oldest ones if full */
+        void push(const Snapshot& snapshot);
+
+        /* Removes the newest frame and copies it into `snapshot`.
+        Returns false if there are none. */
+        bool pop(Snapshot& snapshot);
+
+        /* Drops all the frames */
+        void clear();
+
+        /* Number of frames recorded */
+        std::size_t size() const { return m_frames; }
+
+        /* Bytes held by keyframes and encoded frames */
+        std::size_t memory_usage() const;
+    };
+
+}
+
+
+#endif /* CHIP8_REWIND_H */
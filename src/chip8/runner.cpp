@@ -0,0 +1,296 @@
+#include "runner.h"
+#include "chip8.h"
+#include "headless_renderer.h"
+#include "mapped_file.h"
+#include "predecode.h"
+#include <atomic>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+namespace CHIP8 {
+
+    namespace {
+
+        constexpr uint64_t FNV_OFFSET = 0xCBF29CE484222325ull;
+        constexpr uint64_t FNV_PRIME  = 0x100000001B3ull;
+
+        uint64_t fnv1a(uint64_t hash, const void* data, std::size_t size){
+            const byte_t* bytes = static_cast<const byte_t*>(data);
+            for(std::size_t i = 0; i != size; ++i){
+                hash = (hash ^ bytes[i]) * FNV_PRIME;
+            }
+            return hash;
+        }
+
+        /* ROM file read once for all the jobs that use it */
+        struct RomFile {
+            std::unique_ptr<MappedFile> file;
+            Predecode predecoded; // Shared by every job, whatever its profile
+            std::string error;
+        };
+
+        /* Job indices owned by one worker. The owner takes from the back, thieves from the front. */
+        class WorkQueue {
+            std::mutex m_mutex;
+            std::deque<std::size_t> m_jobs;
+
+        public:
+            void push(std::size_t job){
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_jobs.push_back(job);
+            }
+
+            bool pop(std::size_t& job){
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(m_jobs.empty()){
+                    return false;
+                }
+                job = m_jobs.back();
+                m_jobs.pop_back();
+                return true;
+            }
+
+            bool steal(std::size_t& job){
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(m_jobs.empty()){
+                    return false;
+                }
+                job = m_jobs.front();
+                m_jobs.pop_front();
+                return true;
+            }
+        };
+
+        JobResult run_job(Interpreter& vm, HeadlessRenderer& keypad, const Job& job, const RomFile& rom, std::size_t index){
+            JobResult result{index, ExitReason::COMPLETED, "", 0, 0, 0};
+
+            vm.reset();
+            vm.set_profile(job.profile);
+            vm.set_clock_speed(job.clock_speed);
+            vm.set_timing(job.timing);
+            vm.seed(job.seed);
+            try {
+                if(!rom.error.empty()){
+                    throw std::runtime_error(rom.error);
+                }
+                vm.load_bytes(rom.file->data(), rom.file->size());
+                vm.load_predecode(rom.predecoded);
+            } catch(std::exception& e) {
+                result.reason = ExitReason::LOAD_FAILED;
+                result.error = e.what();
+                return result;
+            }
+
+            for(uint64_t frame = 0; frame != job.frames; ++frame){
+                const uint16_t keys = (frame < job.keys.size()) ? job.keys[frame] : 0;
+                keypad.set_keys(keys);
+                result.instructions += vm.run_frame();
+                if(vm.get_fault()){
+                    result.reason = ExitReason::FAULTED;
+                    result.error = describe_fault(vm.get_fault());
+                    break;
+                }
+            }
+
+            result.state_hash = hash_state(vm.get_state());
+            result.framebuffer_hash = hash_framebuffer(vm.get_framebuffer());
+            return result;
+        }
+    }
+
+    uint64_t hash_bytes(const void* data, std::size_t size){
+        return fnv1a(FNV_OFFSET, data, size);
+    }
+
+    uint64_t hash_state(const State& state){
+        uint64_t hash = FNV_OFFSET;
+        hash = fnv1a(hash, state.ram.data(), state.ram.size());
+        hash = fnv1a(hash, state.stack.data(), state.stack.size() * sizeof(uint16_t));
+        hash = fnv1a(hash, state.regs.data(), state.regs.size());
+        hash = fnv1a(hash, state.rpl.data(), state.rpl.size());
+        hash = fnv1a(hash, &state.DTreg, sizeof(state.DTreg));
+        hash = fnv1a(hash, &state.STreg, sizeof(state.STreg));
+        hash = fnv1a(hash, &state.Ireg, sizeof(state.Ireg));
+        hash = fnv1a(hash, &state.pc, sizeof(state.pc));
+        hash = fnv1a(hash, &state.sp, sizeof(state.sp));
+        return hash;
+    }
+
+    uint64_t hash_framebuffer(const Framebuffer& framebuffer){
+        uint64_t hash = FNV_OFFSET;
+        const int words = framebuffer.is_hires() ? 2 : 1;
+        for(int y = 0; y != framebuffer.get_height(); ++y){
+            for(int word = 0; word != words; ++word){
+                const Framebuffer::row_t row = framebuffer.get_row(y, word);
+                hash = fnv1a(hash, &row, sizeof(row));
+            }
+        }
+        return hash;
+    }
+
+    KeyTrace parse_key_script(std::istream& script, uint64_t frames){
+        KeyTrace trace;
+        std::string line;
+        uint64_t frame;
+        uint16_t keys = 0;
+        while(std::getline(script, line)){
+            if(line.empty() || line[0] == '#'){
+                continue;
+            }
+            std::istringstream fields(line);
+            unsigned mask;
+            if(!(fields >> frame >> std::hex >> mask)){
+                throw std::runtime_error("Invalid input script line: " + line);
+            }
+            // The previous keys hold until this line's frame
+            while(trace.size() < std::min(frame, frames)){
+                trace.push_back(keys);
+            }
+            keys = uint16_t(mask);
+        }
+        while(trace.size() < frames){
+            trace.push_back(keys);
+        }
+        return trace;
+    }
+
+    std::vector<Job> parse_job_list(std::istream& list){
+        std::vector<Job> jobs;
+        std::string line;
+        while(std::getline(list, line)){
+            if(line.empty() || line[0] == '#'){
+                continue;
+            }
+            std::istringstream fields(line);
+            Job job;
+            std::string script = "-";
+            std::string profile = "default";
+            std::string timing = "uniform";
+            if(!(fields >> job.rom >> job.frames >> job.seed)){
+                throw std::runtime_error("Invalid job line: " + line);
+            }
+            fields >> script >> profile >> timing;
+            job.profile = parse_profile(profile);
+            job.timing = parse_timing(timing);
+            if(script != "-"){
+                std::ifstream input(script);
+                if(!input){
+                    throw std::runtime_error("Input script not found: " + script);
+                }
+                job.keys = parse_key_script(input, job.frames);
+            }
+            jobs.push_back(job);
+        }
+        return jobs;
+    }
+
+    const char* exit_reason_name(ExitReason reason){
+        switch(reason){
+            case ExitReason::FAULTED:     return "faulted";
+            case ExitReason::LOAD_FAILED: return "load_failed";
+            case ExitReason::COMPLETED:   break;
+        }
+        return "completed";
+    }
+
+    void run_jobs(
+        const std::vector<Job>& jobs,
+        const std::function<void(const JobResult&)>& on_result,
+        unsigned threads,
+        const std::string& cache_directory
+    ){
+        for(const Job& job : jobs){
+            if(job.clock_speed <= Interpreter::CLOCK_UNTHROTTLED){
+                throw std::runtime_error("Jobs need a fixed clock speed to be reproducible");
+            }
+        }
+
+        // Each ROM is mapped and decoded once rather than by every worker
+        const PredecodeCache cache(cache_directory);
+        std::map<std::string, RomFile> roms;
+        for(const Job& job : jobs){
+            if(roms.count(job.rom)){
+                continue;
+            }
+            RomFile& rom = roms[job.rom];
+            try {
+                rom.file = std::make_unique<MappedFile>(job.rom);
+            } catch(const std::exception& e){
+                rom.error = e.what();
+                continue;
+            }
+            rom.predecoded = cache_directory.empty()
+                ? predecode(rom.file->data(), rom.file->size())
+                : cache.get(rom.file->data(), rom.file->size());
+        }
+
+        if(threads == 0){
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        }
+        threads = unsigned(std::min<std::size_t>(threads, std::max<std::size_t>(jobs.size(), 1)));
+
+        std::vector<WorkQueue> queues(threads);
+        for(std::size_t i = 0; i != jobs.size(); ++i){
+            queues[i % threads].push(i);
+        }
+
+        std::mutex output;
+        std::atomic<bool> stopping(false);
+        std::exception_ptr error; // First exception of a worker, e.g. from on_result
+        auto worker = [&](unsigned self){
+            try {
+                auto vm = Interpreter();
+                auto& keypad = static_cast<HeadlessRenderer&>(vm.get_renderer());
+                std::size_t index;
+                while(!stopping){
+                    bool found = queues[self].pop(index);
+                    for(unsigned i = 1; !found && i != threads; ++i){
+                        found = queues[(self + i) % threads].steal(index);
+                    }
+                    if(!found){
+                        return; // No job is added once running, so all work is done
+                    }
+                    const Job& job = jobs[index];
+                    const JobResult result = run_job(vm, keypad, job, roms.at(job.rom), index);
+                    std::lock_guard<std::mutex> lock(output);
+                    on_result(result);
+                }
+            } catch(...){
+                std::lock_guard<std::mutex> lock(output);
+                if(!error){
+                    error = std::current_exception();
+                }
+                stopping = true;
+            }
+        };
+
+        // Joins the workers on every way out, as destroying a joinable thread terminates
+        struct Pool {
+            std::atomic<bool>& stopping;
+            std::vector<std::thread> threads;
+            ~Pool(){
+                stopping = true; // Only once the calling thread found no job left, or failed
+                for(std::thread& thread : threads){
+                    thread.join();
+                }
+            }
+        };
+        {
+            Pool pool{stopping, {}};
+            for(unsigned i = 1; i < threads; ++i){
+                pool.threads.emplace_back(worker, i);
+            }
+            worker(0);
+        }
+
+        if(error){
+            std::rethrow_exception(error);
+        }
+    }
+}
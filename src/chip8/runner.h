@@ -0,0 +1,87 @@
+#ifndef CHIP8_RUNNER_H
+#define CHIP8_RUNNER_H
+
+#include <cstdint>
+#include <functional>
+#include <istream>
+#include <string>
+#include <vector>
+#include "batch.h"
+#include "chip8.h"
+#include "quirks.h"
+#include "timing.h"
+
+namespace CHIP8 {
+
+    /* A headless session: a ROM run for a number of frames with scripted input */
+    struct Job {
+        std::string rom;  // Path of the ROM file
+        uint64_t frames;
+        uint32_t seed;
+        KeyTrace keys;    // Keypad at each frame
+        Profile profile = Profile::DEFAULT;
+        double clock_speed = Interpreter::DEFAULT_CLOCK_SPEED; // Hz, must not be unthrottled
+        Timing timing = Timing::UNIFORM;
+    };
+
+    /* Why a job stopped */
+    enum class ExitReason {
+        COMPLETED, // Ran all its frames
+        FAULTED,   // The program raised an error, e.g. a stack overflow
+        LOAD_FAILED, // The ROM could not be read or was too large
+    };
+
+    /* Outcome of a job, reported as soon as it finishes */
+    struct JobResult {
+        std::size_t index;     // Position of the job in the list
+        ExitReason reason;
+        std::string error;     // Empty unless the job did not complete
+        uint64_t instructions; // Executed before the job completed or faulted
+        uint64_t state_hash;   // FNV-1a of the final State
+        uint64_t framebuffer_hash; // FNV-1a of the final display
+    };
+
+    /*
+    Reads an input script: one `<frame> <keys>` pair per line, where keys is a
+    hexadecimal mask with bit k set while key k is held. Each line holds from its
+    frame until the next one. Empty lines and lines starting with '#' are ignored.
+    */
+    KeyTrace parse_key_script(std::istream& script, uint64_t frames);
+
+    /*
+    Reads a job list: one `<rom> <frames> <seed> [input script] [profile] [timing]` job per line.
+    An input script of `-` holds no keys. Empty lines and lines starting with '#' are ignored.
+    */
+    std::vector<Job> parse_job_list(std::istream& list);
+
+    /* Returns the FNV-1a hash of `size` bytes */
+    uint64_t hash_bytes(const void* data, std::size_t size);
+
+    /* Returns the hash of a state as reported in `JobResult` */
+    uint64_t hash_state(const State& state);
+
+    /* Returns the hash of a display as reported in `JobResult` */
+    uint64_t hash_framebuffer(const Framebuffer& framebuffer);
+
+    /* Returns the name of an exit reason, e.g. "completed" */
+    const char* exit_reason_name(ExitReason reason);
+
+    /*
+    Runs `jobs` on a work-stealing pool of `threads` workers, or one per
+    hardware thread if zero. Each worker reuses a single headless interpreter.
+    `on_result` is called once per job as it finishes, from one thread at a time,
+    in completion order. If it throws, no further job is started and the exception
+    is rethrown once every worker has stopped. Each ROM is decoded once ahead of the jobs,
+    and the analysis is kept in `cache_directory` across runs if one is given.
+    */
+    void run_jobs(
+        const std::vector<Job>& jobs,
+        const std::function<void(const JobResult&)>& on_result,
+        unsigned threads = 0,
+        const std::string& cache_directory = ""
+    );
+
+}
+
+
+#endif /* CHIP8_RUNNER_H */
@@ -0,0 +1,165 @@
+#include "sfml_renderer.h"
+#include <cstdint>
+
+namespace CHIP8 {
+    
+    /* Creates a window */
+    void SFMLRenderer::init(){
+        if(m_running){
+            throw std::runtime_error("Window already open");
+        }
+
+        // Initialise window
+        sf::VideoMode mode(SCREEN_WIDTH, SCREEN_HEIGHT);
+        m_window = std::make_unique<sf::RenderWindow>(mode, "CHIP8");
+
+        // Setup program display/canvas, large enough for high resolution.
+        // Only the part the current resolution covers is shown.
+        m_texture.create(Framebuffer::WIDTH, Framebuffer::HEIGHT);
+        m_sprite.setTexture(m_texture);
+        m_sprite.setTextureRect(sf::IntRect(0, 0, NATIVE_WIDTH, NATIVE_HEIGHT));
+        m_sprite.setScale(SCREEN_SCALE, SCREEN_SCALE);
+        m_hires = false;
+        m_redraw = true;
+        m_running = true;
+        m_clock.restart();
+    }
+
+    /* True if the window is open */
+    bool SFMLRenderer::is_running(){
+        return m_running;
+    }
+
+    /* Polls events, presents the rows of the framebuffer
+    that changed, and returns frame time in milliseconds */
+    double SFMLRenderer::update(const Framebuffer& framebuffer){
+        return present(framebuffer, nullptr);
+    }
+
+    /* Same as above, for the two bitplanes of XO-CHIP */
+    double SFMLRenderer::update(const Framebuffer& first, const Framebuffer& second){
+        return present(first, &second);
+    }
+
+    /* Presents the framebuffer, overlaid with `second` if not null */
+    double SFMLRenderer::present(const Framebuffer& framebuffer, const Framebuffer* second){
+        if(!m_running){
+            throw std::runtime_error("Window has not been initialised");
+        }
+
+        sf::Event event;
+        while (m_window->pollEvent(event)) {
+            if(event.type == sf::Event::Closed){
+                m_running = false;
+                m_window->close();
+            } else if(event.type == sf::Event::KeyPressed || event.type == sf::Event::KeyReleased){
+                process_key(event.key.code, event.type == sf::Event::KeyPressed);
+            } else if(event.type == sf::Event::LostFocus){
+                // Releases are not reported to unfocused windows
+                m_keypad.set_keys(0);
+                m_rewind = false;
+            } else if(event.type == sf::Event::Resized || event.type == sf::Event::GainedFocus){
+                // Window contents may have been lost
+                m_redraw = true;
+            }
+        }
+
+        // Show the part of the texture the resolution covers, at the same window size
+        if(framebuffer.is_hires() != m_hires){
+            m_hires = framebuffer.is_hires();
+            const int scale = m_hires ? SCREEN_SCALE / 2 : SCREEN_SCALE;
+            m_sprite.setTextureRect(sf::IntRect(0, 0, framebuffer.get_width(), framebuffer.get_height()));
+            m_sprite.setScale(scale, scale);
+            m_redraw = true;
+        }
+
+        Framebuffer::mask_t dirty = framebuffer.get_dirty_rows();
+        if(second){
+            dirty |= second->get_dirty_rows();
+        }
+        if(m_redraw){
+            dirty = ~Framebuffer::mask_t(0);
+        }
+
+        // Unchanged frames are neither uploaded nor redrawn
+        if(m_running && dirty != 0){
+            // Upload each run of consecutive changed rows as one sub-rectangle
+            const int width = framebuffer.get_width();
+            const int height = framebuffer.get_height();
+            int y = 0;
+            while(y != height){
+                if(!((dirty >> y) & 0x1)){
+                    ++y;
+                    continue;
+                }
+                int first = y;
+                while(y != height && ((dirty >> y) & 0x1)){
+                    ++y;
+                }
+                convert_rows(framebuffer, second, first, y);
+                m_texture.update(
+                    m_pixels.data() + first * width * 4,
+                    width, y - first, 0, first
+                );
+            }
+
+            m_window->clear();
+            m_window->draw(m_sprite);
+            m_window->display();
+            m_redraw = false;
+        }
+
+        return m_clock.restart().asMicroseconds() / 1000.0;
+    }
+
+    /* Converts scanlines [first, last) of the framebuffer, and of the second plane if any, into RGBA pixels */
+    void SFMLRenderer::convert_rows(const Framebuffer& framebuffer, const Framebuffer* second, int first, int last){
+        const sf::Color palette[4] = {
+            m_theme.first, m_theme.second, m_plane_colors.first, m_plane_colors.second
+        };
+        const int width = framebuffer.get_width();
+        sf::Uint8* pixel = m_pixels.data() + first * width * 4;
+        for(int y = first; y != last; ++y){
+            for(int x = 0; x != width; ++x){
+                // Each row is one 64-bit word per 64 columns
+                const int shift = 63 - x % 64;
+                int index = (framebuffer.get_row(y, x / 64) >> shift) & 0x1;
+                if(second){
+                    index |= ((second->get_row(y, x / 64) >> shift) & 0x1) << 1;
+                }
+                const sf::Color& color = palette[index];
+                pixel[0] = color.r;
+                pixel[1] = color.g;
+                pixel[2] = color.b;
+                pixel[3] = color.a;
+                pixel += 4;
+            }
+        }
+    }
+
+    /* Defines the two colors used on the canvas */
+    void SFMLRenderer::set_theme(sf::Color primary, sf::Color secondary){
+        m_theme.first  = primary;
+        m_theme.second = secondary;
+        m_redraw = true;
+    }
+
+    /* Presses or releases the keypad key or rewind bound to a keyboard key */
+    void SFMLRenderer::process_key(sf::Keyboard::Key code, bool pressed){
+        if(code == m_rewind_binding){
+            m_rewind = pressed;
+            return;
+        }
+        for(byte_t key = 0x0; key != 0x10; ++key){
+            if(m_key_bindings[key] == code){
+                m_keypad.set_key(key, pressed);
+                return;
+            }
+        }
+    }
+
+    /* Returns true while Backspace is held */
+    bool SFMLRenderer::is_rewind_pressed(){
+        return m_rewind;
+    }
+}
\ No newline at end of file
@@ -0,0 +1,88 @@
+#ifndef CHIP8_SFML_RENDERER_H
+#define CHIP8_SFML_RENDERER_H
+
+#include <SFML/Graphics.hpp>
+#include <atomic>
+#include "renderer.h"
+
+namespace CHIP8 {
+
+    /* Renders the canvas on a window and updates the keypad from keyboard events */
+    class SFMLRenderer : public Renderer {
+
+    private:
+        std::array<sf::Uint8, Framebuffer::WIDTH * Framebuffer::HEIGHT * 4> m_pixels; // RGBA, rows of the current width
+        sf::Texture m_texture;
+        sf::Sprite  m_sprite;
+        sf::Clock   m_clock;
+        std::unique_ptr<sf::RenderWindow> m_window;
+        std::pair<sf::Color, sf::Color>   m_theme;
+        std::pair<sf::Color, sf::Color>   m_plane_colors; // Second plane only, and both planes
+        bool m_running;
+        bool m_redraw; // Upload the whole framebuffer on the next update
+        bool m_hires;  // Resolution the texture is showing
+        std::atomic<bool> m_rewind; // Read by the emulation thread
+        const sf::Keyboard::Key m_rewind_binding = sf::Keyboard::Key::BackSpace;
+        const std::array<sf::Keyboard::Key, 0x10> m_key_bindings = {
+            sf::Keyboard::Key::Num0,
+            sf::Keyboard::Key::Num1,
+            sf::Keyboard::Key::Num2,
+            sf::Keyboard::Key::Num3,
+            sf::Keyboard::Key::Num4,
+            sf::Keyboard::Key::Num5,
+            sf::Keyboard::Key::Num6,
+            sf::Keyboard::Key::Num7,
+            sf::Keyboard::Key::Num8,
+            sf::Keyboard::Key::Num9,
+            sf::Keyboard::Key::A   ,
+            sf::Keyboard::Key::B   ,
+            sf::Keyboard::Key::C   ,
+            sf::Keyboard::Key::D   ,
+            sf::Keyboard::Key::E   ,
+            sf::Keyboard::Key::F   ,
+        };
+
+    public:
+        SFMLRenderer()
+            : m_theme(sf::Color::Black, sf::Color::White),
+              m_plane_colors(sf::Color(0xAA, 0xAA, 0xAA), sf::Color(0x55, 0x55, 0x55)),
+              m_running(false),
+              m_redraw(true),
+              m_hires(false),
+              m_rewind(false){ }
+        
+        ~SFMLRenderer() { }
+
+        /* Creates a window */
+        void init() override;
+
+        /* True if the window is open */
+        bool is_running() override;
+
+        /* Polls events, presents the rows of the framebuffer
+        that changed, and returns frame time in milliseconds */
+        double update(const Framebuffer& framebuffer) override;
+
+        /* Same as above, for the two bitplanes of XO-CHIP */
+        double update(const Framebuffer& first, const Framebuffer& second) override;
+
+        /* Presents the framebuffer, overlaid with `second` if not null */
+        double present(const Framebuffer& framebuffer, const Framebuffer* second);
+
+        /* Converts scanlines [first, last) of the framebuffer, and of the second plane if any, into RGBA pixels */
+        void convert_rows(const Framebuffer& framebuffer, const Framebuffer* second, int first, int last);
+
+        /* Defines the two colors used on the canvas */
+        void set_theme(sf::Color bright, sf::Color dark);
+
+        /* Presses or releases the keypad key or rewind bound to a keyboard key */
+        void process_key(sf::Keyboard::Key code, bool pressed);
+
+        /* Returns true while Backspace is held */
+        bool is_rewind_pressed() override;
+
+    };
+}
+
+
+#endif /* CHIP8_SFML_RENDERER_H */
\ No newline at end of file
@@ -0,0 +1,45 @@
+#include "snapshot.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    SnapshotHeader SnapshotHeader::current(){
+        return SnapshotHeader{{'C', '8', 'S', 'S'}, Snapshot::VERSION, 0x0102, uint32_t(sizeof(Snapshot)), 0};
+    }
+
+    bool SnapshotHeader::is_compatible() const {
+        const SnapshotHeader expected = current();
+        return std::memcmp(magic, expected.magic, sizeof(magic)) == 0
+            && version == expected.version
+            && byte_order == expected.byte_order
+            && size == expected.size;
+    }
+
+    SnapshotFile::SnapshotFile(const std::string& filename)
+        : m_file(filename), m_snapshots(nullptr), m_count(0) {
+        // Mappings are page aligned and buffers aligned for any type, so snapshots are used in place
+        if(m_file.size() == 0 || m_file.size() % sizeof(Snapshot) != 0){
+            throw std::runtime_error("Snapshot file is empty or truncated");
+        }
+        m_snapshots = reinterpret_cast<const Snapshot*>(m_file.data());
+        m_count = m_file.size() / sizeof(Snapshot);
+        for(std::size_t i = 0; i != m_count; ++i){
+            if(!m_snapshots[i].header.is_compatible()){
+                throw std::runtime_error("Snapshot was written by an incompatible version");
+            }
+        }
+    }
+
+    void write_snapshot(const std::string& filename, const Snapshot& snapshot, bool append){
+        std::ofstream output(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+        if(!output){
+            throw std::runtime_error("Could not open snapshot file for writing");
+        }
+        output.write(reinterpret_cast<const char*>(&snapshot), sizeof(Snapshot));
+        if(!output){
+            throw std::runtime_error("Could not write snapshot file");
+        }
+    }
+}
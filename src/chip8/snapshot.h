@@ -0,0 +1,77 @@
+#ifndef CHIP8_SNAPSHOT_H
+#define CHIP8_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include "state.h"
+#include "framebuffer.h"
+#include "mapped_file.h"
+#include "random.h"
+
+namespace CHIP8 {
+
+    /* Identifies a snapshot and the build layout it was written with */
+    struct SnapshotHeader {
+        char     magic[4];   // "C8SS"
+        uint16_t version;
+        uint16_t byte_order; // 0x0102 as written by the host
+        uint32_t size;       // Bytes in the whole snapshot
+        uint32_t reserved;
+
+        /* Returns the header of snapshots written by this build */
+        static SnapshotHeader current();
+
+        /* Returns true if a snapshot with this header can be loaded by this build */
+        bool is_compatible() const;
+    };
+
+    /*
+    Everything needed to resume a virtual machine, about 5.2 KB.
+    It is a plain structure, so saving and loading in memory are single copies
+    and a file of snapshots can be memory-mapped and used in place.
+    The file format is the structure itself, so it is only portable between
+    builds with the same layout, which the header records and checks.
+    */
+    struct Snapshot {
+        static constexpr uint16_t VERSION = 3; // Version 2 had no SUPER-CHIP display or flags
+
+        SnapshotHeader header;
+        State          state;
+        Framebuffer    framebuffer;
+        Random         rng;
+        double         timer;        // Milliseconds accumulated towards the next timer tick
+        double         cycle_budget; // Instructions owed to the current frame
+    };
+    static_assert(std::is_trivially_copyable<Snapshot>::value, "Snapshots are copied as bytes");
+
+    /*
+    Read-only view of a file holding one or more consecutive snapshots,
+    memory-mapped where the platform allows it so that they are not copied.
+    */
+    class SnapshotFile {
+        MappedFile      m_file;
+        const Snapshot* m_snapshots;
+        std::size_t     m_count;
+
+    public:
+        /* Opens a snapshot file. Throws if it is missing, truncated or incompatible. */
+        explicit SnapshotFile(const std::string& filename);
+
+        SnapshotFile(const SnapshotFile&) = delete;
+        SnapshotFile& operator=(const SnapshotFile&) = delete;
+
+        /* Number of snapshots in the file */
+        std::size_t size() const { return m_count; }
+
+        /* Returns a snapshot by position in the file */
+        const Snapshot& operator[](std::size_t index) const { return m_snapshots[index]; }
+    };
+
+    /* Writes a snapshot to disk. Appends to the file if `append` is set, building a library. */
+    void write_snapshot(const std::string& filename, const Snapshot& snapshot, bool append = false);
+
+}
+
+
+#endif /* CHIP8_SNAPSHOT_H */
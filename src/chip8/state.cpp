@@ -1,5 +1,4 @@
 #include "state.h"
-#include <stdexcept>
 
 namespace CHIP8 {
     
@@ -12,25 +11,27 @@ namespace CHIP8 {
         ram.fill(0);
         stack.fill(0);
         regs.fill(0);
+        rpl.fill(0);
 
-        // Copy hex digits to the front of the RAM
+        // Copy hex digits to the front of the RAM, followed by the large ones
         std::copy_n(HEX_DIGITS.begin(), HEX_ALPHABET_SIZE, ram.begin());
+        std::copy_n(BIG_HEX_DIGITS.begin(), BIG_HEX_ALPHABET_SIZE, ram.begin() + BIG_HEX_ALPHABET_OFFSET);
     }
 
-    uint16_t State::advance(){
+    bool State::advance(){
         if(pc + 2 >= RAM_SIZE){
-            throw std::runtime_error("RAM overflow");
+            return false;
         }
-        uint16_t code = (ram[pc] << 8) | ram[pc+1];
         pc += 2;
-        return code;
+        return true;
     }
 
     /* Jumps to the specified address in RAM */
-    void State::jump(uint16_t address){
+    bool State::jump(uint16_t address){
         if(address >= CHIP8::RAM_SIZE){
-            throw std::runtime_error("RAM overflow");
+            return false;
         }
         pc = address;
+        return true;
     }
 }
\ No newline at end of file
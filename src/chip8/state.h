@@ -39,6 +39,34 @@ namespace CHIP8 {
         0xF0, 0x80, 0xF0, 0x80, 0x80, /* F */
     };
 
+    // Number of bytes to store the large SUPER-CHIP representation of one hex digit (8x10 pixels)
+    static constexpr byte_t BIG_HEX_DIGIT_SIZE = 10;
+    // Address of the large digits in RAM, after the small ones
+    static constexpr uint16_t BIG_HEX_ALPHABET_OFFSET = HEX_ALPHABET_SIZE;
+    static constexpr byte_t BIG_HEX_ALPHABET_SIZE = 0x10 * BIG_HEX_DIGIT_SIZE;
+
+    static const std::array<byte_t, BIG_HEX_ALPHABET_SIZE> BIG_HEX_DIGITS = {
+        0x3C, 0x7E, 0xE7, 0xC3, 0xC3, 0xC3, 0xC3, 0xE7, 0x7E, 0x3C, /* 0 */
+        0x18, 0x38, 0x58, 0x18, 0x18, 0x18, 0x18, 0x18, 0x18, 0x3C, /* 1 */
+        0x3E, 0x7F, 0xC3, 0x06, 0x0C, 0x18, 0x30, 0x60, 0xFF, 0xFF, /* 2 */
+        0x3C, 0x7E, 0xC3, 0x03, 0x0E, 0x0E, 0x03, 0xC3, 0x7E, 0x3C, /* 3 */
+        0x06, 0x0E, 0x1E, 0x36, 0x66, 0xC6, 0xFF, 0xFF, 0x06, 0x06, /* 4 */
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFE, 0x03, 0xC3, 0x7E, 0x3C, /* 5 */
+        0x3E, 0x7C, 0xC0, 0xC0, 0xFC, 0xFE, 0xC3, 0xC3, 0x7E, 0x3C, /* 6 */
+        0xFF, 0xFF, 0x03, 0x06, 0x0C, 0x18, 0x30, 0x60, 0x60, 0x60, /* 7 */
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7E, 0x7E, 0xC3, 0xC3, 0x7E, 0x3C, /* 8 */
+        0x3C, 0x7E, 0xC3, 0xC3, 0x7F, 0x3F, 0x03, 0x03, 0x3E, 0x7C, /* 9 */
+        0x18, 0x3C, 0x66, 0xC3, 0xC3, 0xFF, 0xFF, 0xC3, 0xC3, 0xC3, /* A */
+        0xFC, 0xFE, 0xC3, 0xC3, 0xFE, 0xFE, 0xC3, 0xC3, 0xFE, 0xFC, /* B */
+        0x3C, 0x7E, 0xC3, 0xC0, 0xC0, 0xC0, 0xC0, 0xC3, 0x7E, 0x3C, /* C */
+        0xFC, 0xFE, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xC3, 0xFE, 0xFC, /* D */
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xFF, 0xFF, /* E */
+        0xFF, 0xFF, 0xC0, 0xC0, 0xFC, 0xFC, 0xC0, 0xC0, 0xC0, 0xC0, /* F */
+    };
+
+    // Number of SUPER-CHIP user flags saved and restored by Fx75 and Fx85
+    static constexpr byte_t RPL_FLAG_NUM = 16;
+
     struct State {
         // Memory
         std::array<byte_t,   RAM_SIZE>     ram;
@@ -46,6 +74,7 @@ namespace CHIP8 {
 
         // Registers
         std::array<byte_t,   REGISTER_NUM> regs;
+        std::array<byte_t,   RPL_FLAG_NUM> rpl; // SUPER-CHIP user flags, kept across programs on the HP-48
         byte_t   DTreg; // delay timer, 8bit register
         byte_t   STreg; // sound timer, 8bit register
         uint16_t Ireg;  // address store, 16bit register
@@ -62,11 +91,13 @@ namespace CHIP8 {
         /* Resets all memory */
         void reset();
 
-        /* Moves the program counter and returns the last opcode */
-        uint16_t advance();
+        /* Moves the program counter to the next instruction.
+        Returns false, leaving it unchanged, if that would pass the end of RAM. */
+        bool advance();
 
-        /* Jumps to the specified address in RAM */
-        void jump(uint16_t address);
+        /* Jumps to the specified address in RAM.
+        Returns false, leaving the program counter unchanged, if it is outside RAM. */
+        bool jump(uint16_t address);
     };
 
 }
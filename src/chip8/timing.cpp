@@ -0,0 +1,118 @@
+#include "timing.h"
+#include <stdexcept>
+
+namespace CHIP8 {
+
+    namespace {
+
+        constexpr CycleCosts make_uniform(){
+            CycleCosts costs{};
+            for(uint16_t& cycles : costs.op){
+                cycles = 1;
+            }
+            return costs;
+        }
+
+        /*
+        Each instruction costs the fetch and dispatch of the VIP interpreter,
+        about 40 machine cycles, plus its own routine. Drawing and clearing
+        take longest, as the 1802 moves the display one byte at a time.
+        Display DMA and the 60 Hz interrupt are not modelled.
+        */
+        constexpr CycleCosts make_cosmac_vip(){
+            constexpr uint16_t DISPATCH = 40;
+            CycleCosts costs{};
+            auto set = [&costs](Op op, uint16_t cycles){
+                costs.op[std::size_t(op)] = DISPATCH + cycles;
+            };
+            set(Op::UNDECODED, 0);
+            set(Op::UNKNOWN,   0);
+            set(Op::SYS,       0);
+            set(Op::CLS,       3000);
+            set(Op::RET,       10);
+            set(Op::JP,        12);
+            set(Op::CALL,      26);
+            set(Op::SE_BYTE,   10);
+            set(Op::SNE_BYTE,  10);
+            set(Op::SE_REG,    18);
+            set(Op::LD_BYTE,   6);
+            set(Op::ADD_BYTE,  10);
+            for(Op op : {Op::LD_REG, Op::OR, Op::AND, Op::XOR, Op::ADD_REG, Op::SUB, Op::SHR, Op::SUBN, Op::SHL}){
+                set(op, 44);
+            }
+            set(Op::SNE_REG,   18);
+            set(Op::LD_I,      12);
+            set(Op::JP_V0,     22);
+            set(Op::RND,       36);
+            set(Op::DRW,       170);
+            set(Op::SKP,       18);
+            set(Op::SKNP,      18);
+            set(Op::LD_VX_DT,  10);
+            set(Op::LD_KEY,    18);
+            set(Op::LD_DT,     10);
+            set(Op::LD_ST,     10);
+            set(Op::ADD_I,     16);
+            set(Op::LD_FONT,   16);
+            set(Op::LD_BCD,    220);
+            set(Op::LD_STORE,  14);
+            set(Op::LD_LOAD,   14);
+            // SUPER-CHIP never ran on the VIP, these follow its closest instructions
+            set(Op::SCD,       3000);
+            set(Op::SCR,       3000);
+            set(Op::SCL,       3000);
+            set(Op::EXIT,      0);
+            set(Op::LOW,       3000);
+            set(Op::HIGH,      3000);
+            set(Op::LD_HF,     16);
+            set(Op::LD_R,      14);
+            set(Op::LD_VX_R,   14);
+            // Nor did XO-CHIP
+            set(Op::LD_I_LONG, 20);
+            set(Op::SAVE_RANGE, 18);
+            set(Op::LOAD_RANGE, 18);
+            set(Op::PLANE,     10);
+            set(Op::AUDIO,     130);
+            set(Op::PITCH,     10);
+            costs.per_sprite_row = 100;
+            costs.per_register = 14;
+            return costs;
+        }
+
+        constexpr CycleCosts UNIFORM_COSTS = make_uniform();
+        constexpr CycleCosts COSMAC_VIP_COSTS = make_cosmac_vip();
+    }
+
+    bool CycleCosts::is_uniform() const {
+        for(uint16_t cycles : op){
+            if(cycles != 1){
+                return false;
+            }
+        }
+        return per_sprite_row == 0 && per_register == 0;
+    }
+
+    const CycleCosts& get_cycle_costs(Timing timing){
+        switch(timing){
+            case Timing::COSMAC_VIP: return COSMAC_VIP_COSTS;
+            case Timing::UNIFORM:    break;
+        }
+        return UNIFORM_COSTS;
+    }
+
+    const char* timing_name(Timing timing){
+        switch(timing){
+            case Timing::COSMAC_VIP: return "vip";
+            case Timing::UNIFORM:    break;
+        }
+        return "uniform";
+    }
+
+    Timing parse_timing(const std::string& name){
+        for(Timing timing : {Timing::UNIFORM, Timing::COSMAC_VIP}){
+            if(name == timing_name(timing)){
+                return timing;
+            }
+        }
+        throw std::runtime_error("Unknown timing: " + name);
+    }
+}
@@ -0,0 +1,59 @@
+#ifndef CHIP8_TIMING_H
+#define CHIP8_TIMING_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include "state.h"
+#include "instruction.h"
+
+namespace CHIP8 {
+
+    /*
+    Cost of each operation in cycles of the emulated clock.
+    The clock speed of the interpreter is in cycles per second, and
+    emulated time, which the timers count, advances with the cycles run.
+    */
+    struct CycleCosts {
+        std::array<uint16_t, std::size_t(Op::COUNT)> op; // Indexed by operation
+        uint16_t per_sprite_row; // Added to DRW for each row drawn
+        uint16_t per_register;   // Added to Fx55 and Fx65 for each register copied
+
+        /* Returns the cycles taken by an instruction */
+        uint32_t of(const Instruction& ins) const {
+            uint32_t cycles = op[std::size_t(ins.op)];
+            if(ins.op == Op::DRW){
+                cycles += uint32_t(per_sprite_row) * ins.n;
+            } else if(ins.op == Op::LD_STORE || ins.op == Op::LD_LOAD){
+                cycles += uint32_t(per_register) * (ins.x + 1);
+            }
+            return cycles;
+        }
+
+        /* True if every instruction takes one cycle */
+        bool is_uniform() const;
+    };
+
+    /* Cycle cost tables selectable at run time */
+    enum class Timing : byte_t {
+        UNIFORM,    // One cycle per instruction: the clock speed is the instruction rate
+        COSMAC_VIP, // Approximate machine cycles taken by the interpreter of the COSMAC VIP
+    };
+
+    /* Machine cycles per second of the COSMAC VIP, a 1.76 MHz CDP1802 with 8 clocks per cycle */
+    static constexpr double COSMAC_VIP_CYCLE_RATE = 1760640.0 / 8;
+
+    /* Returns the costs of a timing */
+    const CycleCosts& get_cycle_costs(Timing timing);
+
+    /* Returns the name of a timing, as accepted by `parse_timing` */
+    const char* timing_name(Timing timing);
+
+    /* Returns the timing named `name` (uniform, vip).
+    Throws if the name is not recognised. */
+    Timing parse_timing(const std::string& name);
+
+}
+
+
+#endif /* CHIP8_TIMING_H */
@@ -0,0 +1,56 @@
+#ifndef CHIP8_TRIPLE_BUFFER_H
+#define CHIP8_TRIPLE_BUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace CHIP8 {
+
+    /*
+    Hands the newest value from one producer thread to one consumer thread
+    without locks, and without either ever waiting for the other.
+    The producer writes the back slot and the consumer reads the front one.
+    Publishing swaps the back slot with the middle one, and taking a value
+    swaps the front slot with it. Values published faster than they are
+    taken replace each other in the middle slot.
+    */
+    template<class T>
+    class TripleBuffer {
+        static constexpr uint8_t INDEX = 0x3;
+        static constexpr uint8_t FRESH = 0x4; // Set while the middle slot holds a value not yet taken
+
+        std::array<T, 3> m_slots;
+        std::atomic<uint8_t> m_middle; // Index of the middle slot and FRESH
+        uint8_t m_back;  // Only used by the producer
+        uint8_t m_front; // Only used by the consumer
+
+    public:
+        TripleBuffer() : m_slots{}, m_middle(1), m_back(0), m_front(2) { }
+
+        /* Slot the producer writes the next value to */
+        T& back() { return m_slots[m_back]; }
+
+        /* Makes the value in the back slot the newest, and gives the producer another slot */
+        void publish(){
+            // Release makes the value visible to the consumer that acquires it
+            m_back = m_middle.exchange(m_back | FRESH, std::memory_order_acq_rel) & INDEX;
+        }
+
+        /* Moves the newest value to the front slot. Returns false if none was published since. */
+        bool take(){
+            if(!(m_middle.load(std::memory_order_relaxed) & FRESH)){
+                return false;
+            }
+            m_front = m_middle.exchange(m_front, std::memory_order_acq_rel) & INDEX;
+            return true;
+        }
+
+        /* Slot the consumer reads, holding the value last taken */
+        T& front() { return m_slots[m_front]; }
+    };
+
+}
+
+
+#endif /* CHIP8_TRIPLE_BUFFER_H */
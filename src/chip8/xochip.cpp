@@ -0,0 +1,19 @@
+#include "xochip.h"
+#include <cmath>
+
+namespace CHIP8 {
+
+    void XoChip::reset(){
+        high_ram.fill(0);
+        plane.clear();
+        plane.set_hires(false);
+        plane.mark_all_dirty();
+        pattern.fill(0);
+        pitch = 64;
+        planes = 0x1;
+    }
+
+    double XoChip::get_sample_rate() const {
+        return 4000.0 * std::pow(2.0, (pitch - 64) / 48.0);
+    }
+}
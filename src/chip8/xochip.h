@@ -0,0 +1,46 @@
+#ifndef CHIP8_XOCHIP_H
+#define CHIP8_XOCHIP_H
+
+#include <array>
+#include <cstdint>
+#include "state.h"
+#include "framebuffer.h"
+
+namespace CHIP8 {
+
+    // Size of the XO-CHIP address space
+    static constexpr uint32_t XO_RAM_SIZE = 0x10000;
+    // Bytes of the 1-bit audio pattern loaded by F002
+    static constexpr byte_t AUDIO_PATTERN_SIZE = 16;
+
+    /*
+    State only XO-CHIP programs use: the memory past the first RAM_SIZE bytes,
+    the second bitplane, the selected planes and the audio pattern.
+    The interpreter only allocates it with the XO-CHIP profile, so that
+    classic programs keep a 4 KB `State` and a single plane.
+    */
+    struct XoChip {
+        std::array<byte_t, XO_RAM_SIZE - RAM_SIZE> high_ram; // 0x1000-0xFFFF
+        Framebuffer plane;  // Second bitplane, the first is the framebuffer of the interpreter
+        std::array<byte_t, AUDIO_PATTERN_SIZE> pattern; // 128 samples, most significant bit first
+        byte_t pitch;       // Playback rate of the pattern, see `get_sample_rate`
+        byte_t planes;      // Planes drawn to, bit 0 for the first and bit 1 for the second
+
+        XoChip() { reset(); }
+
+        /* Clears memory, plane and audio, and selects the first plane */
+        void reset();
+
+        /* Returns the byte at `address` of the address space, whose first RAM_SIZE bytes are in `state` */
+        byte_t& at(State& state, uint16_t address){
+            return (address < RAM_SIZE) ? state.ram[address] : high_ram[address - RAM_SIZE];
+        }
+
+        /* Returns the samples per second the audio pattern plays at, 4000 Hz at the default pitch of 64 */
+        double get_sample_rate() const;
+    };
+
+}
+
+
+#endif /* CHIP8_XOCHIP_H */
@@ -1,20 +1,192 @@
 
 #include "chip8/chip8.h"
+#include "chip8/runner.h"
+#include "chip8/movie.h"
+#include "chip8/mapped_file.h"
 
-#include "chip8/renderer.h"
+#if defined(CHIP8_WITH_SFML)
+#include "chip8/sfml_renderer.h"
+#endif
 
-int main(int argc, const char* argv[]) {
-    
-    if(argc != 2){
-        std::cout << 
-        "Supply filename" << std::endl;
+#include <iomanip>
+
+/* Escapes a string for a JSON value */
+static std::string json_string(const std::string& text){
+    std::string escaped = "\"";
+    for(char c : text){
+        if(c == '"' || c == '\\'){
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped + "\"";
+}
+
+/* Prints the result of a job as a JSON line */
+static void print_result(const CHIP8::JobResult& result, const CHIP8::Job& job){
+    std::cout << std::setfill('0')
+        << "{\"job\": " << result.index
+        << ", \"rom\": " << json_string(job.rom)
+        << ", \"exit\": \"" << CHIP8::exit_reason_name(result.reason) << "\""
+        << ", \"error\": " << json_string(result.error)
+        << ", \"instructions\": " << result.instructions
+        << ", \"state_hash\": \"" << std::hex << std::setw(16) << result.state_hash << "\""
+        << ", \"framebuffer_hash\": \"" << std::setw(16) << result.framebuffer_hash << "\""
+        << "}" << std::dec << std::endl;
+}
+
+/* Runs a job list headless and prints one JSON line per job as it finishes */
+static int run_batch(const char* filename, unsigned threads, const char* cache_directory){
+    std::ifstream list(filename);
+    if(!list){
+        std::cerr << "Job list not found" << std::endl;
         return 1;
     }
-    
-    auto chip8 = CHIP8::Interpreter();
-    chip8.load_file(argv[1]);
+    const std::vector<CHIP8::Job> jobs = CHIP8::parse_job_list(list);
+
+    CHIP8::run_jobs(jobs, [&](const CHIP8::JobResult& result){
+        print_result(result, jobs[result.index]);
+    }, threads, cache_directory);
+    return 0;
+}
+
+/* Replays a movie headless as fast as possible and prints the outcome */
+static int run_replay(const char* movie_file, const char* rom_file){
+    std::ifstream input(movie_file);
+    if(!input){
+        std::cerr << "Movie not found" << std::endl;
+        return 1;
+    }
+    const CHIP8::Movie movie = CHIP8::read_movie(input);
+    const CHIP8::MappedFile rom(rom_file);
+    if(CHIP8::hash_rom(rom.data(), rom.size()) != movie.rom_hash){
+        std::cerr << "Movie was recorded on a different ROM" << std::endl;
+        return 1;
+    }
+
+    const std::vector<CHIP8::Job> jobs = {CHIP8::movie_job(movie, rom_file)};
+    const auto start = std::chrono::steady_clock::now();
+    CHIP8::run_jobs(jobs, [&](const CHIP8::JobResult& result){
+        print_result(result, jobs[0]);
+    }, 1);
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Replayed " << movie.keys.size() << " frames in " << elapsed << " s, "
+        << (movie.keys.size() / CHIP8::Interpreter::FRAME_RATE) / elapsed << "x real time" << std::endl;
+    return 0;
+}
+
+/* Prints the command line options */
+static void print_usage(){
+    std::cout << 
+    "Usage: chip8 [--record <movie>] [--profile <report>] [--timing uniform|vip] [--cache <directory>] <filename>"
+    " [clock speed in Hz, 0 for unthrottled] [quirk profile: default, vip, chip48, schip, xochip]\n"
+    "       chip8 --replay <movie> <filename>\n"
+    "       chip8 --batch <job list> [threads] [cache directory]" << std::endl;
+}
+
+#if defined(CHIP8_WITH_SFML)
+/* Runs a program in a window, given the arguments after the name of the executable */
+static int run_session(int argc, const char* argv[]){
+    // Sessions can be recorded as a movie for `--replay`, profiled into a report,
+    // timed by the cycles each instruction takes and predecoded from a cache
+    const char* movie_file = nullptr;
+    const char* cache_directory = nullptr;
+    const char* report_file = nullptr;
+    const char* timing = "uniform";
+    while(argc >= 3){
+        const std::string option = argv[1];
+        if(option == "--record"){
+            movie_file = argv[2];
+        } else if(option == "--profile"){
+            report_file = argv[2];
+        } else if(option == "--timing"){
+            timing = argv[2];
+        } else if(option == "--cache"){
+            cache_directory = argv[2];
+        } else {
+            break;
+        }
+        argv += 2;
+        argc -= 2;
+    }
+
+    if(argc < 2 || argc > 4){
+        print_usage();
+        return 1;
+    }
+#if !defined(CHIP8_PROFILE)
+    if(report_file){
+        std::cerr << "Built without the profiler, configure with -DCHIP8_ENABLE_PROFILER=ON to use --profile" << std::endl;
+        return 1;
+    }
+#endif
+
+    auto chip8 = CHIP8::Interpreter(std::make_unique<CHIP8::SFMLRenderer>());
+    chip8.set_timing(CHIP8::parse_timing(timing));
+    if(argc >= 3){
+        chip8.set_clock_speed(std::stod(argv[2]));
+    } else if(CHIP8::parse_timing(timing) == CHIP8::Timing::COSMAC_VIP){
+        chip8.set_clock_speed(CHIP8::COSMAC_VIP_CYCLE_RATE);
+    }
+    if(argc == 4){
+        chip8.set_profile(CHIP8::parse_profile(argv[3]));
+    }
+    chip8.set_rewind_length(std::size_t(5 * 60 * CHIP8::Interpreter::FRAME_RATE)); // Five minutes
+
+    const CHIP8::MappedFile rom(argv[1]);
+    CHIP8::Movie movie;
+    movie.rom_hash = CHIP8::hash_rom(rom.data(), rom.size());
+    movie.seed = uint32_t(std::time(nullptr));
+    movie.profile = chip8.get_profile();
+    movie.clock_speed = chip8.get_clock_speed();
+    movie.timing = CHIP8::parse_timing(timing);
+    chip8.seed(movie.seed);
+    chip8.load_bytes(rom.data(), rom.size());
+    if(cache_directory){
+        chip8.load_predecode(CHIP8::PredecodeCache(cache_directory).get(rom.data(), rom.size()));
+    }
+    if(movie_file){
+        chip8.set_recording(&movie);
+    }
+    if(report_file){
+        chip8.enable_profiler();
+    }
     chip8.run();
 
+    if(report_file && chip8.get_profiler()){
+        std::ofstream output(report_file);
+        chip8.get_profiler()->write_report(output);
+    }
+
+    if(movie_file){
+        std::ofstream output(movie_file);
+        CHIP8::write_movie(output, movie);
+    }
+    if(chip8.get_fault()){
+        std::cerr << CHIP8::describe_fault(chip8.get_fault()) << std::endl;
+    }
+    std::cout << "Instruction rate: " << chip8.get_instruction_rate() << " Hz" << std::endl;
+    return 0;
+}
+#endif
+
+int main(int argc, const char* argv[]) {
+    
+    if(argc >= 3 && std::string(argv[1]) == "--batch"){
+        return run_batch(argv[2], (argc >= 4) ? std::stoul(argv[3]) : 0, (argc >= 5) ? argv[4] : "");
+    }
+    if(argc == 4 && std::string(argv[1]) == "--replay"){
+        return run_replay(argv[2], argv[3]);
+    }
+
+#if defined(CHIP8_WITH_SFML)
+    return run_session(argc, argv);
+#else
+    std::cerr << "Built without SFML, only --batch and --replay are available" << std::endl;
+    print_usage();
+    return 1;
+#endif
+
     /*
     auto renderer = CHIP8::Renderer();
     renderer.init();
@@ -0,0 +1,40 @@
+
+#include "chip8/aot.h"
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+int main(int argc, const char* argv[]) {
+
+    if(argc < 3 || argc > 5){
+        std::cout <<
+        "Usage: chip8_aot <rom> <output.cpp> [symbol] [quirk profile]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::binary);
+    if(!input){
+        std::cerr << "Input file not found" << std::endl;
+        return 1;
+    }
+    std::vector<CHIP8::byte_t> rom(
+        (std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>()
+    );
+
+    std::ofstream output(argv[2]);
+    if(!output){
+        std::cerr << "Could not open output file" << std::endl;
+        return 1;
+    }
+
+    try {
+        CHIP8::generate_cpp(
+            rom, (argc >= 4) ? argv[3] : "compiled_program", output,
+            (argc == 5) ? CHIP8::parse_profile(argv[4]) : CHIP8::Profile::DEFAULT
+        );
+    } catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
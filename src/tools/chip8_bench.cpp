@@ -0,0 +1,253 @@
+
+#include "chip8/chip8.h"
+
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* A timed run and the instructions it executed */
+struct Result {
+    std::string name;
+    std::string kind; // "micro" or "rom"
+    std::string engine;
+    uint64_t instructions;
+    double seconds;
+};
+
+/* Opcodes executed in turn with `run_instruction`, on a state prepared by `setup` */
+struct Micro {
+    const char* name;
+    std::vector<uint16_t> opcodes;
+    std::function<void(CHIP8::State&)> setup;
+};
+
+/* Synthetic ROM run headless through an engine */
+struct Rom {
+    const char* name;
+    std::vector<CHIP8::byte_t> program;
+};
+
+static void setup_registers(CHIP8::State& state){
+    for(int i = 0; i != 16; ++i){
+        state.regs[i] = CHIP8::byte_t(i * 17 + 3);
+    }
+    state.Ireg = 0x300;
+}
+
+static const std::vector<Micro> MICROS = {
+    // 8XYN, every arithmetic and logic operation
+    {"alu", {0x8010, 0x8121, 0x8232, 0x8343, 0x8454, 0x8565, 0x8677, 0x878E}, setup_registers},
+    // 3XNN, 4XNN, 5XY0 and 9XY0, taken and not taken
+    {"skip", {0x3003, 0x3103, 0x4003, 0x4103, 0x5010, 0x5000, 0x9010, 0x9000}, setup_registers},
+    // 2NNN and 00EE in pairs, so the stack stays balanced
+    {"call_ret", {0x2300, 0x00EE}, setup_registers},
+    // DXYN with one, eight and fifteen rows, unaligned so rows straddle two bytes
+    {"draw_1", {0xD011}, setup_registers},
+    {"draw_8", {0xD018}, setup_registers},
+    {"draw_15", {0xD01F}, setup_registers},
+    // FX33, FX55 and FX65 on all registers, writing data outside the program
+    {"bcd", {0xF533}, setup_registers},
+    {"store", {0xFF55}, setup_registers},
+    {"load", {0xFF65}, setup_registers},
+};
+
+static const std::vector<Rom> ROMS = {
+    // Arithmetic in a tight loop
+    {"alu_loop", {
+        0x60, 0x01, // 0x200: V0 = 1
+        0x61, 0x03, // 0x202: V1 = 3
+        0x80, 0x14, // 0x204: V0 += V1
+        0x81, 0x05, // 0x206: V1 -= V0
+        0x82, 0x02, // 0x208: V2 &= V0
+        0x83, 0x11, // 0x20A: V3 |= V1
+        0x84, 0x23, // 0x20C: V4 ^= V2
+        0x85, 0x06, // 0x20E: V5 >>= 1
+        0x86, 0x0E, // 0x210: V6 <<= 1
+        0x77, 0x01, // 0x212: V7 += 1
+        0x12, 0x04, // 0x214: Jump to 0x204
+    }},
+    // Digits drawn across the screen, cleared once it is full
+    {"sprites", {
+        0x00, 0xE0, // 0x200: Clear screen
+        0x60, 0x00, // 0x202: V0 = 0
+        0x61, 0x00, // 0x204: V1 = 0
+        0xF2, 0x29, // 0x206: I = sprite of digit V2
+        0xD0, 0x15, // 0x208: Draw it at V0, V1
+        0x72, 0x01, // 0x20A: V2 += 1
+        0x70, 0x05, // 0x20C: V0 += 5
+        0x30, 0x3C, // 0x20E: Skip if V0 == 60
+        0x12, 0x06, // 0x210: Jump to 0x206
+        0x60, 0x00, // 0x212: V0 = 0
+        0x71, 0x06, // 0x214: V1 += 6
+        0x31, 0x1E, // 0x216: Skip if V1 == 30
+        0x12, 0x06, // 0x218: Jump to 0x206
+        0x12, 0x00, // 0x21A: Jump to 0x200
+    }},
+    // Decimal conversion and register dumps to memory
+    {"memory", {
+        0xA3, 0x00, // 0x200: I = 0x300
+        0x75, 0x01, // 0x202: V5 += 1
+        0xF5, 0x33, // 0x204: Store BCD of V5 at I
+        0xF2, 0x65, // 0x206: Load V0-V2 from I
+        0x80, 0x14, // 0x208: V0 += V1
+        0x80, 0x24, // 0x20A: V0 += V2
+        0xF8, 0x55, // 0x20C: Store V0-V8 at I
+        0x12, 0x02, // 0x20E: Jump to 0x202
+    }},
+    // Nested subroutines and conditional skips
+    {"calls", {
+        0x22, 0x10, // 0x200: Call 0x210
+        0x70, 0x01, // 0x202: V0 += 1
+        0x30, 0x00, // 0x204: Skip if V0 == 0
+        0x12, 0x00, // 0x206: Jump to 0x200
+        0x71, 0x01, // 0x208: V1 += 1
+        0x12, 0x00, // 0x20A: Jump to 0x200
+        0x00, 0x00,
+        0x00, 0x00,
+        0x72, 0x01, // 0x210: V2 += 1
+        0x22, 0x20, // 0x212: Call 0x220
+        0x00, 0xEE, // 0x214: Return
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x00, 0x00,
+        0x42, 0x00, // 0x220: Skip if V2 != 0
+        0x73, 0x01, // 0x222: V3 += 1
+        0x00, 0xEE, // 0x224: Return
+    }},
+};
+
+static double seconds_since(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Result run_micro(const Micro& micro, uint64_t count){
+    auto vm = CHIP8::Interpreter();
+    vm.seed(1);
+    micro.setup(vm.get_state());
+    const std::size_t size = micro.opcodes.size();
+    count -= count % size;
+
+    // The program counter is rewound after each round, as skips only move it forward
+    CHIP8::State& state = vm.get_state();
+    const auto start = std::chrono::steady_clock::now();
+    for(uint64_t i = 0; i != count; i += size){
+        for(uint16_t code : micro.opcodes){
+            vm.run_instruction(code);
+        }
+        state.pc = 0x200;
+    }
+    return {micro.name, "micro", "run_instruction", count, seconds_since(start)};
+}
+
+static Result run_rom(const Rom& rom, CHIP8::Engine engine, const char* engine_name, uint64_t count){
+    auto vm = CHIP8::Interpreter();
+    vm.seed(1);
+    vm.set_engine(engine);
+    vm.load_bytes(rom.program);
+
+    const auto start = std::chrono::steady_clock::now();
+    const uint64_t executed = vm.run_instructions(count);
+    return {rom.name, "rom", engine_name, executed, seconds_since(start)};
+}
+
+static void print_json(const std::vector<Result>& results){
+    // Emulated frames at the default clock speed
+    const double instructions_per_frame = CHIP8::Interpreter::DEFAULT_CLOCK_SPEED / CHIP8::Interpreter::FRAME_RATE;
+#if defined(NDEBUG)
+    const char* build = "release";
+#else
+    const char* build = "debug";
+#endif
+
+    std::cout << "{\"build\": \"" << build << "\", \"benchmarks\": [";
+    for(std::size_t i = 0; i != results.size(); ++i){
+        const Result& r = results[i];
+        const double rate = r.instructions / r.seconds;
+        std::cout << (i ? ",\n  " : "\n  ")
+            << "{\"name\": \"" << r.kind << "/" << r.name << "\""
+            << ", \"engine\": \"" << r.engine << "\""
+            << ", \"instructions\": " << r.instructions
+            << ", \"seconds\": " << r.seconds
+            << ", \"instructions_per_second\": " << rate
+            << ", \"ns_per_instruction\": " << 1e9 / rate
+            << ", \"frames_per_second\": " << rate / instructions_per_frame
+            << "}";
+    }
+    std::cout << "\n]}" << std::endl;
+}
+
+static void print_table(const std::vector<Result>& results){
+    const double instructions_per_frame = CHIP8::Interpreter::DEFAULT_CLOCK_SPEED / CHIP8::Interpreter::FRAME_RATE;
+    std::cout << std::left << std::setw(18) << "benchmark" << std::setw(17) << "engine"
+        << std::right << std::setw(14) << "instr/s" << std::setw(12) << "ns/instr" << std::setw(14) << "frames/s" << "\n";
+    for(const Result& r : results){
+        const double rate = r.instructions / r.seconds;
+        std::cout << std::left << std::setw(18) << (r.kind + "/" + r.name) << std::setw(17) << r.engine
+            << std::right << std::fixed << std::setprecision(0) << std::setw(14) << rate
+            << std::setprecision(2) << std::setw(12) << 1e9 / rate
+            << std::setprecision(0) << std::setw(14) << rate / instructions_per_frame << "\n";
+    }
+    std::cout << std::flush;
+}
+
+int main(int argc, const char* argv[]) {
+
+    bool json = false;
+    uint64_t count = 20000000;
+    std::string filter;
+    for(int i = 1; i < argc; ++i){
+        const std::string arg = argv[i];
+        if(arg == "--json"){
+            json = true;
+        } else if(arg == "--instructions" && i + 1 < argc){
+            count = std::stoull(argv[++i]);
+        } else if(arg == "--filter" && i + 1 < argc){
+            filter = argv[++i];
+        } else {
+            std::cout <<
+            "Usage: chip8_bench [--json] [--instructions <count per benchmark>] [--filter <name substring>]" << std::endl;
+            return 1;
+        }
+    }
+
+#if !defined(NDEBUG)
+    std::cerr << "Warning: built without optimisation, configure with -DCMAKE_BUILD_TYPE=Release" << std::endl;
+#endif
+
+    auto selected = [&](const std::string& name){
+        return filter.empty() || name.find(filter) != std::string::npos;
+    };
+
+    std::vector<Result> results;
+    for(const Micro& micro : MICROS){
+        if(selected(std::string("micro/") + micro.name)){
+            results.push_back(run_micro(micro, count));
+        }
+    }
+
+    const std::vector<std::pair<CHIP8::Engine, const char*>> engines = {
+        {CHIP8::Engine::SWITCH, "switch"},
+        {CHIP8::Engine::THREADED, "threaded"},
+#if defined(CHIP8_JIT)
+        {CHIP8::Engine::JIT, "jit"},
+#endif
+    };
+    for(const Rom& rom : ROMS){
+        for(const auto& engine : engines){
+            if(selected(std::string("rom/") + rom.name)){
+                results.push_back(run_rom(rom, engine.first, engine.second, count));
+            }
+        }
+    }
+
+    if(json){
+        print_json(results);
+    } else {
+        print_table(results);
+    }
+}
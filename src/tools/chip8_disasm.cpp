@@ -0,0 +1,39 @@
+
+#include "chip8/disassembler.h"
+#include "chip8/mapped_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+
+int main(int argc, const char* argv[]) {
+
+    if(argc < 2 || argc > 3){
+        std::cout <<
+        "Usage: chip8_disasm <rom> [block list]" << std::endl;
+        return 1;
+    }
+
+    try {
+        const CHIP8::MappedFile rom(argv[1]);
+        std::array<CHIP8::byte_t, CHIP8::RAM_SIZE> ram{};
+        const std::size_t size = std::min<std::size_t>(rom.size(), CHIP8::RAM_SIZE - CHIP8::RAM_PROG_OFFSET);
+        std::copy_n(rom.data(), size, ram.begin() + CHIP8::RAM_PROG_OFFSET);
+        const uint16_t limit = uint16_t(CHIP8::RAM_PROG_OFFSET + size);
+
+        const CHIP8::ProgramMap map = CHIP8::analyse_program(ram, CHIP8::RAM_PROG_OFFSET, limit);
+        CHIP8::write_listing(std::cout, ram, map, CHIP8::RAM_PROG_OFFSET, limit);
+
+        if(argc == 3){
+            std::ofstream blocks(argv[2]);
+            if(!blocks){
+                std::cerr << "Could not open block list for writing" << std::endl;
+                return 1;
+            }
+            CHIP8::write_block_list(blocks, map);
+        }
+    } catch(const std::exception& e){
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -1,6 +1,16 @@
 
 #include "../src/chip8/chip8.h"
+#include "../src/chip8/headless_renderer.h"
+#include "../src/chip8/batch.h"
+#include "../src/chip8/runner.h"
+#include "../src/chip8/movie.h"
+#include "../src/chip8/mapped_file.h"
+#include "../src/chip8/disassembler.h"
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+#include <thread>
 
 /*
 Checks the initial state of the program
@@ -60,12 +70,13 @@ TEST_CASE("0x2nnn - Call subroutine when stack is full", "[opcodes]"){
     auto& state = prog.get_state();
 
     state.sp = CHIP8::STACK_SIZE - 1;
-    bool exception_thrown = true;
-    try {
-       prog.run_instruction(0x2FFF); // Call (0x2) to address 0xFFF
-       exception_thrown = false;
-    } catch (std::exception& e) { }
-    REQUIRE(exception_thrown);
+    state.pc = 0x202;
+    prog.run_instruction(0x2FFF); // Call (0x2) to address 0xFFF
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::STACK_OVERFLOW);
+    REQUIRE(prog.get_fault().pc == 0x200);
+    REQUIRE(prog.get_fault().opcode == 0x2FFF);
+    REQUIRE(state.sp == CHIP8::STACK_SIZE - 1);
+    REQUIRE(state.pc == 0x202);
 }
 
 
@@ -89,13 +100,8 @@ TEST_CASE("0x00EE - Return from subroutine when no subroutine was called", "[opc
     auto& state = prog.get_state();
 
     state.sp = 0;
-    bool exception_thrown = true;
-    try {
-        prog.run_instruction(0x00EE); // Return (0x00EE)
-        exception_thrown = false;
-    } catch (const std::exception& e) { }
-
-    REQUIRE(exception_thrown);
+    prog.run_instruction(0x00EE); // Return (0x00EE)
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::STACK_UNDERFLOW);
 }
 
 
@@ -157,13 +163,8 @@ TEST_CASE("0x3xkk - Conditionally skipping an instruction leads to RAM overflow"
 
     state.pc = CHIP8::RAM_SIZE - 2;
     state.regs[0x0] = 0x0;
-    bool exception_thrown = false;
-    try {
-        prog.run_instruction(0x3000); // Skip if (0x3) register 0x0 equals 0x0
-    } catch (std::exception& e) {
-        exception_thrown = true;
-    }
-    REQUIRE(exception_thrown);
+    prog.run_instruction(0x3000); // Skip if (0x3) register 0x0 equals 0x0
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
     REQUIRE(state.pc == CHIP8::RAM_SIZE - 2);
 }
 
@@ -196,12 +197,8 @@ TEST_CASE("0x4xkk - Skipping an instruction leads to RAM overflow", "[opcodes]")
     
     state.pc = 0xFFE;
     state.regs[0xA] = 0x0;
-    bool exception_thrown = true;
-    try {
-        prog.run_instruction(0x4A01); // Skip if register 0xA does not equal 0x01
-        exception_thrown = false;
-    } catch (std::exception& e) { }
-    REQUIRE(exception_thrown);
+    prog.run_instruction(0x4A01); // Skip if register 0xA does not equal 0x01
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
     REQUIRE(state.pc == 0xFFE);
 }
 
@@ -237,13 +234,8 @@ TEST_CASE("0x5xy0 - Skipping an instruction leads to RAM overflow", "[opcodes]")
     state.reset();
     state.pc = 0xFFE;
     state.regs[0] = 0x0;
-    bool exception_thrown = false;
-    try {
-        prog.run_instruction(0x5000); // Skip if (0x5) register 0x0 equals itself
-    } catch (std::exception& e) {
-        exception_thrown = true;
-    }
-    REQUIRE(exception_thrown);
+    prog.run_instruction(0x5000); // Skip if (0x5) register 0x0 equals itself
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
     REQUIRE(state.pc == 0xFFE);
 }
 
@@ -501,12 +493,9 @@ TEST_CASE("Jump if registers do not equal instruction", "[opcodes]"){
     state.pc = 0xFFF;
     state.regs[0xa] = 0xff;
     state.regs[0xb] = 0x00;
-    bool exception_thrown = true;
-    try {
-        prog.run_instruction(0x9ab0);
-        exception_thrown = false;
-    } catch (std::exception& e) { }
-    REQUIRE((exception_thrown && state.pc <= 0xFFF));
+    prog.run_instruction(0x9ab0);
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
+    REQUIRE(state.pc == 0xFFF);
 }
 
 /*
@@ -546,13 +535,9 @@ TEST_CASE("Jump to V0 plus offset instruction", "[opcodes]"){
 
     // RAM overflow
     state.regs[0x0] = 0xFF;
-    bool exception_thrown = false;
-    try {
-        prog.run_instruction(0xBFFF); // Jumps to 0xFF + 0xFFF
-    } catch (std::exception& e){
-        exception_thrown = true;
-    }
-    REQUIRE(exception_thrown);
+    prog.run_instruction(0xBFFF); // Jumps to 0xFF + 0xFFF
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
+    REQUIRE(state.pc == (0xAA + 0xBB));
 }
 
 /*
@@ -565,7 +550,20 @@ TEST_CASE("Random byte instruction", "[opcodes]"){
     auto prog = CHIP8::Interpreter();
     auto& state = prog.get_state();
     state.pc = 0;
-    /// TODO: need to reset rng between calls to test
+
+    // The same seed gives the same bytes, masked by kk
+    prog.seed(1234);
+    prog.run_instruction(0xC0FF);
+    prog.run_instruction(0xC10F);
+    const CHIP8::byte_t first = state.regs[0x0];
+    const CHIP8::byte_t second = state.regs[0x1];
+    REQUIRE((second & 0xF0) == 0x0);
+
+    prog.seed(1234);
+    prog.run_instruction(0xC0FF);
+    prog.run_instruction(0xC10F);
+    REQUIRE(state.regs[0x0] == first);
+    REQUIRE(state.regs[0x1] == second);
 }
 
 /*
@@ -578,7 +576,30 @@ If this causes any pixels to be erased, VF is set to 1, otherwise it is set to 0
 If the sprite is positioned so part of it is outside the coordinates of the display,
 it wraps around to the opposite side of the screen. 
 */
-/// TODO
+TEST_CASE("Draw sprite instruction", "[opcodes]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    auto& display = prog.get_framebuffer();
+    state.pc = 0;
+
+    // Draw the top row of digit '0' (0xF0) at (62, 1), wrapping horizontally
+    state.Ireg = 0x0;
+    state.regs[0xa] = 62;
+    state.regs[0xb] = 1;
+    prog.run_instruction(0xDab1);
+    REQUIRE(display.get_pixel(62, 1));
+    REQUIRE(display.get_pixel(63, 1));
+    REQUIRE(display.get_pixel(0, 1));
+    REQUIRE(display.get_pixel(1, 1));
+    REQUIRE_FALSE(display.get_pixel(2, 1));
+    REQUIRE(state.regs[0xF] == 0x0);
+
+    // Drawing it again erases the pixels and sets the collision flag
+    prog.run_instruction(0xDab1);
+    REQUIRE_FALSE(display.get_pixel(62, 1));
+    REQUIRE_FALSE(display.get_pixel(0, 1));
+    REQUIRE(state.regs[0xF] == 0x1);
+}
 
 /*
 Ex9E - SKP Vx
@@ -586,7 +607,20 @@ Skip next instruction if key with the value of Vx is pressed.
 Checks the keyboard, and if the key corresponding
 to the value of Vx is currently in the down position, PC is increased by 2.
 */
-/// TODO
+TEST_CASE("Skip if key pressed instruction", "[opcodes]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    auto& keypad = static_cast<CHIP8::HeadlessRenderer&>(prog.get_renderer());
+    state.pc = 0;
+
+    state.regs[0xa] = 0x5;
+    prog.run_instruction(0xEa9E);
+    REQUIRE(state.pc == 0);
+
+    keypad.set_key(0x5, true);
+    prog.run_instruction(0xEa9E);
+    REQUIRE(state.pc == 2);
+}
 
 /*
 ExA1 - SKNP Vx
@@ -594,7 +628,21 @@ Skip next instruction if key with the value of Vx is not pressed.
 Checks the keyboard, and if the key corresponding
 to the value of Vx is currently in the up position, PC is increased by 2.
 */
-/// TODO
+TEST_CASE("Skip if key not pressed instruction", "[opcodes]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    auto& keypad = static_cast<CHIP8::HeadlessRenderer&>(prog.get_renderer());
+    state.pc = 0;
+
+    state.regs[0xa] = 0x5;
+    keypad.set_key(0x5, true);
+    prog.run_instruction(0xEaA1);
+    REQUIRE(state.pc == 0);
+
+    keypad.set_key(0x5, false);
+    prog.run_instruction(0xEaA1);
+    REQUIRE(state.pc == 2);
+}
 
 /*
 Fx07 - LD Vx, DT
@@ -616,7 +664,74 @@ Fx0A - LD Vx, K
 Wait for a key press, store the value of the key in Vx.
 All execution stops until a key is pressed, then the value of that key is stored in Vx.
 */
-/// TODO
+TEST_CASE("Wait for key press instruction", "[opcodes]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    auto& keypad = static_cast<CHIP8::HeadlessRenderer&>(prog.get_renderer());
+    
+    // Program counter stays on the instruction until a key is pressed
+    state.pc = 2;
+    prog.run_instruction(0xFa0A);
+    REQUIRE(state.pc == 0);
+
+    state.pc = 2;
+    keypad.set_key(0xC, true);
+    prog.run_instruction(0xFa0A);
+    REQUIRE(state.pc == 2);
+    REQUIRE(state.regs[0xa] == 0xC);
+}
+
+TEST_CASE("The keypad is a mask written from any thread", "[keypad]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    CHIP8::Keypad& keypad = prog.get_renderer().get_keypad();
+
+    // Input arrives on another thread, as window events may
+    std::thread input([&](){
+        keypad.set_key(0x9, true);
+        keypad.set_key(0x3, true);
+    });
+    input.join();
+    REQUIRE(keypad.get_keys() == 0x0208);
+
+    // The lowest key pressed is the one waited for
+    state.pc = 2;
+    prog.run_instruction(0xF10A);
+    REQUIRE(state.pc == 2);
+    REQUIRE(state.regs[0x1] == 0x3);
+
+    keypad.set_key(0x3, false);
+    state.regs[0x2] = 0x9;
+    prog.run_instruction(0xE29E);
+    REQUIRE(state.pc == 4);
+    state.regs[0x2] = 0x19; // Only the low nibble selects the key
+    prog.run_instruction(0xE2A1);
+    REQUIRE(state.pc == 4);
+
+    keypad.set_keys(0);
+    prog.run_instruction(0xE2A1);
+    REQUIRE(state.pc == 6);
+
+    // Keys are read once per call, so input arriving mid-frame waits for the next one
+    const std::vector<CHIP8::byte_t> program = {
+        0xE2, 0x9E, // 0x200: Skip if key V2 is pressed
+        0x60, 0x01, // 0x202: V0 = 1
+        0x00, 0x00, // 0x204: Nothing
+    };
+    prog.reset();
+    prog.load_bytes(program);
+    state.regs[0x2] = 0x9;
+    keypad.set_key(0x9, true);
+    prog.run_instructions(1);
+    REQUIRE(state.pc == 0x204);
+    keypad.set_key(0x9, false);
+    state.pc = 0x200;
+    prog.execute(CHIP8::decode(0xE29E)); // Still the keys of the last call, so it skips
+    REQUIRE(state.pc == 0x202);
+    state.pc = 0x200;
+    prog.run_instructions(1);
+    REQUIRE(state.pc == 0x202);
+}
 
 
 /*
@@ -750,3 +865,1372 @@ TEST_CASE("Set V register values from RAM instruction", "[opcodes]"){
     }
 }
 
+
+
+TEST_CASE("Run the instructions scheduled for one frame", "[scheduler]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    prog.load_bytes({
+        0x70, 0x01, // Add 1 to V0
+        0x12, 0x00  // Jump to 0x200
+    });
+
+    prog.set_clock_speed(600); // 10 instructions per frame
+    REQUIRE(prog.run_frame() == 10);
+    REQUIRE(state.regs[0x0] == 5);
+
+    // Fractional instructions are carried over to later frames
+    prog.set_clock_speed(450); // 7.5 instructions per frame
+    REQUIRE(prog.run_frame() == 7);
+    REQUIRE(prog.run_frame() == 8);
+
+    // Unthrottled frames run at least one batch of instructions
+    prog.set_clock_speed(CHIP8::Interpreter::CLOCK_UNTHROTTLED);
+    REQUIRE(prog.run_frame() > 0);
+}
+
+
+TEST_CASE("Clear screen instruction", "[opcodes]"){
+    auto prog = CHIP8::Interpreter();
+    auto& display = prog.get_framebuffer();
+
+    display.draw_byte(0, 0, 0xFF);
+    display.draw_byte(56, 31, 0xFF);
+    prog.run_instruction(0x00E0);
+    for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+        REQUIRE(display.get_row(y) == 0x0);
+    }
+}
+
+
+TEST_CASE("Sprites wrap around the edges of the framebuffer", "[framebuffer]"){
+    CHIP8::Framebuffer display;
+    const CHIP8::byte_t sprite[] = {0x81, 0x81};
+
+    // Bottom-right corner: second row wraps to the top, rightmost bit to the left
+    REQUIRE_FALSE(display.draw_sprite(57, 31, sprite, 2));
+    REQUIRE(display.get_pixel(57, 31));
+    REQUIRE(display.get_pixel(0, 31));
+    REQUIRE(display.get_pixel(57, 0));
+    REQUIRE(display.get_pixel(0, 0));
+    REQUIRE(display.get_row(0) == 0x8000000000000040);
+
+    REQUIRE(display.draw_sprite(57, 31, sprite, 1));
+    REQUIRE(display.get_row(31) == 0x0);
+}
+
+
+TEST_CASE("Framebuffer tracks the rows modified since the last present", "[framebuffer]"){
+    CHIP8::Framebuffer display;
+    display.clear_dirty();
+
+    // Drawing an empty byte changes nothing
+    display.draw_byte(0, 3, 0x00);
+    REQUIRE(display.get_dirty_rows() == 0x0);
+
+    display.draw_byte(0, 3, 0xFF);
+    display.draw_byte(60, 33, 0x01); // Wraps to row 1
+    REQUIRE(display.get_dirty_rows() == 0b1010);
+
+    // Clearing only flags rows that had pixels lit
+    display.clear_dirty();
+    display.clear();
+    REQUIRE(display.get_dirty_rows() == 0b1010);
+
+    display.clear_dirty();
+    display.clear();
+    REQUIRE(display.get_dirty_rows() == 0x0);
+}
+
+
+TEST_CASE("Decoded instructions are refreshed when RAM is written", "[decode]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    prog.load_bytes({0x63, 0x00}); // Set V3 to 0x00
+
+    prog.step();
+    REQUIRE(state.regs[0x3] == 0x00);
+
+    // Self-modifying code: overwrite the instruction with Fx55
+    state.pc = 0x200;
+    state.Ireg = 0x200;
+    state.regs[0x0] = 0x63;
+    state.regs[0x1] = 0x42; // Set V3 to 0x42
+    prog.run_instruction(0xF155);
+    prog.step();
+    REQUIRE(state.regs[0x3] == 0x42);
+
+    // Fx33 writes three bytes starting at I
+    state.pc = 0x200;
+    state.Ireg = 0x1FF;
+    state.regs[0x0] = 123;
+    prog.run_instruction(0xF033);
+    REQUIRE(state.ram[0x200] == 2);
+    state.ram[0x200] = 0x63; // Direct writes require explicit invalidation
+    prog.invalidate_decoded(0x200, 1);
+    prog.step();
+    REQUIRE(state.regs[0x3] == 3);
+
+    // Loading a new program replaces any cached instructions
+    state.pc = 0x200;
+    prog.load_bytes({0x63, 0x11});
+    prog.step();
+    REQUIRE(state.regs[0x3] == 0x11);
+}
+
+
+TEST_CASE("Decode opcodes into operations and operands", "[decode]"){
+    CHIP8::Instruction ins = CHIP8::decode(0xD12F);
+    REQUIRE(ins.op == CHIP8::Op::DRW);
+    REQUIRE(ins.x == 0x1);
+    REQUIRE(ins.y == 0x2);
+    REQUIRE(ins.n == 0xF);
+    REQUIRE(ins.kk == 0x2F);
+    REQUIRE(ins.nnn == 0x12F);
+
+    REQUIRE(CHIP8::decode(0x00E0).op == CHIP8::Op::CLS);
+    REQUIRE(CHIP8::decode(0x0123).op == CHIP8::Op::SYS);
+    REQUIRE(CHIP8::decode(0x8AB8).op == CHIP8::Op::UNKNOWN);
+    REQUIRE(CHIP8::decode(0xF265).op == CHIP8::Op::LD_LOAD);
+}
+
+
+TEST_CASE("Quirk profiles change the ambiguous instructions", "[quirks]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    REQUIRE(prog.get_profile() == CHIP8::Profile::DEFAULT);
+
+    // 8xy6 shifts Vy into Vx on the COSMAC VIP, Vx in place on CHIP-48
+    prog.set_profile(CHIP8::Profile::COSMAC_VIP);
+    state.regs[0x1] = 0x10;
+    state.regs[0x2] = 0x03;
+    prog.run_instruction(0x8126);
+    REQUIRE(state.regs[0x1] == 0x01);
+    REQUIRE(state.regs[0xF] == 0x1);
+
+    prog.set_profile(CHIP8::Profile::CHIP48);
+    state.regs[0x1] = 0x10;
+    prog.run_instruction(0x8126);
+    REQUIRE(state.regs[0x1] == 0x08);
+    REQUIRE(state.regs[0xF] == 0x0);
+
+    // 8xy1 resets VF only on the COSMAC VIP
+    state.regs[0xF] = 0x5;
+    prog.run_instruction(0x8121);
+    REQUIRE(state.regs[0xF] == 0x5);
+    prog.set_profile(CHIP8::Profile::COSMAC_VIP);
+    prog.run_instruction(0x8121);
+    REQUIRE(state.regs[0xF] == 0x0);
+
+    // Fx55 advances I by x + 1 on the COSMAC VIP, x on CHIP-48 and not at all on SUPER-CHIP
+    state.Ireg = 0x300;
+    prog.run_instruction(0xF255);
+    REQUIRE(state.Ireg == 0x303);
+    prog.set_profile(CHIP8::Profile::CHIP48);
+    prog.run_instruction(0xF265);
+    REQUIRE(state.Ireg == 0x305);
+    prog.set_profile(CHIP8::Profile::SCHIP);
+    prog.run_instruction(0xF255);
+    REQUIRE(state.Ireg == 0x305);
+
+    // Bxnn adds Vx on SUPER-CHIP and V0 on XO-CHIP
+    state.regs[0x0] = 0x01;
+    state.regs[0x3] = 0x10;
+    prog.run_instruction(0xB320);
+    REQUIRE(state.pc == 0x330);
+    prog.set_profile(CHIP8::Profile::XO_CHIP);
+    prog.run_instruction(0xB320);
+    REQUIRE(state.pc == 0x321);
+
+    REQUIRE(CHIP8::parse_profile("vip") == CHIP8::Profile::COSMAC_VIP);
+    REQUIRE_THROWS(CHIP8::parse_profile("cosmac"));
+}
+
+
+TEST_CASE("High resolution framebuffer draws and scrolls whole words", "[framebuffer]"){
+    CHIP8::Framebuffer display;
+    display.set_hires(true);
+    REQUIRE(display.get_width() == 128);
+    REQUIRE(display.get_height() == 64);
+
+    // A 16x16 sprite straddling the two words of each row, wrapping at the bottom
+    std::array<CHIP8::byte_t, 32> sprite;
+    sprite.fill(0xFF);
+    REQUIRE_FALSE(display.draw_sprite_16(60, 56, sprite.data()));
+    REQUIRE(display.get_row(56, 0) == 0xF);
+    REQUIRE(display.get_row(56, 1) == 0xFFF0000000000000);
+    REQUIRE(display.get_row(7, 1) == 0xFFF0000000000000);
+    REQUIRE(display.get_row(8, 0) == 0x0);
+    REQUIRE(display.get_pixel(75, 3));
+    REQUIRE_FALSE(display.get_pixel(76, 3));
+
+    // Sprites wrap from the right edge to the left one
+    CHIP8::Framebuffer wrapped;
+    wrapped.set_hires(true);
+    const CHIP8::byte_t byte[] = {0xFF};
+    wrapped.draw_sprite(124, 0, byte, 1);
+    REQUIRE(wrapped.get_row(0, 0) == 0xF000000000000000);
+    REQUIRE(wrapped.get_row(0, 1) == 0xF);
+
+    // Scrolling carries pixels across the words
+    display.scroll_right();
+    REQUIRE(display.get_row(56, 0) == 0x0);
+    REQUIRE(display.get_row(56, 1) == 0xFFFF000000000000);
+    display.scroll_left();
+    display.scroll_left();
+    REQUIRE(display.get_row(56, 0) == 0xFF);
+    REQUIRE(display.get_row(56, 1) == 0xFF00000000000000);
+    display.scroll_down(4);
+    REQUIRE(display.get_row(0, 0) == 0x0);
+    REQUIRE(display.get_row(4, 0) == 0xFF);
+    REQUIRE(display.get_row(11, 1) == 0xFF00000000000000);
+    REQUIRE(display.get_row(12, 1) == 0x0);
+    REQUIRE(display.get_dirty_rows() == ~CHIP8::Framebuffer::mask_t(0));
+
+    // Changing resolution clears the display
+    display.set_hires(false);
+    for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+        REQUIRE(display.get_row(y, 0) == 0x0);
+        REQUIRE(display.get_row(y, 1) == 0x0);
+    }
+}
+
+
+TEST_CASE("SUPER-CHIP instructions only run with the SUPER-CHIP profile", "[quirks]"){
+    auto prog = CHIP8::Interpreter();
+    auto& state = prog.get_state();
+    auto& display = prog.get_framebuffer();
+
+    // Ignored by the default profile
+    prog.run_instruction(0x00FF);
+    REQUIRE_FALSE(display.is_hires());
+    state.regs[0x0] = 0x7;
+    prog.run_instruction(0xF030);
+    REQUIRE(state.Ireg == 0x0);
+
+    prog.set_profile(CHIP8::Profile::SCHIP);
+    prog.run_instruction(0x00FF);
+    REQUIRE(display.is_hires());
+
+    // Fx30 points I at the large digit of Vx
+    prog.run_instruction(0xF030);
+    REQUIRE(state.Ireg == CHIP8::BIG_HEX_ALPHABET_OFFSET + 7 * CHIP8::BIG_HEX_DIGIT_SIZE);
+    REQUIRE(state.ram[state.Ireg] == 0xFF);
+
+    // Dxy0 draws 16x16 pixels
+    state.Ireg = 0x300;
+    std::fill_n(state.ram.begin() + 0x300, 32, 0xFF);
+    state.regs[0x1] = 100;
+    state.regs[0x2] = 40;
+    prog.run_instruction(0xD120);
+    REQUIRE(state.regs[0xF] == 0);
+    REQUIRE(display.get_pixel(100, 40));
+    REQUIRE(display.get_pixel(115, 55));
+    REQUIRE_FALSE(display.get_pixel(116, 55));
+    prog.run_instruction(0xD120);
+    REQUIRE(state.regs[0xF] == 1);
+
+    // 00Cn, 00FB and 00FC scroll the display
+    prog.run_instruction(0xD120);
+    prog.run_instruction(0x00C3);
+    REQUIRE(display.get_pixel(100, 43));
+    REQUIRE_FALSE(display.get_pixel(100, 42));
+    prog.run_instruction(0x00FB);
+    REQUIRE(display.get_pixel(104, 43));
+    REQUIRE_FALSE(display.get_pixel(103, 43));
+    prog.run_instruction(0x00FC);
+    REQUIRE(display.get_pixel(100, 43));
+
+    // Fx75 and Fx85 save and restore V0-Vx
+    for(CHIP8::byte_t i = 0; i != CHIP8::REGISTER_NUM; ++i){
+        state.regs[i] = i + 1;
+    }
+    prog.run_instruction(0xF375);
+    state.regs.fill(0);
+    prog.run_instruction(0xF285);
+    REQUIRE(state.regs[0x0] == 1);
+    REQUIRE(state.regs[0x2] == 3);
+    REQUIRE(state.regs[0x3] == 0);
+
+    // 00FD stays on itself and 00FE returns to low resolution
+    prog.load_bytes({0x00, 0xFE, 0x00, 0xFD});
+    prog.run_instructions(10);
+    REQUIRE(state.pc == 0x202);
+    REQUIRE_FALSE(display.is_hires());
+
+    // In low resolution Dxy0 draws 8x16 pixels, one byte per row, and VF reports any collision
+    state.Ireg = 0x300;
+    std::fill_n(state.ram.begin() + 0x300, 16, 0xFF);
+    state.regs[0x1] = 10;
+    state.regs[0x2] = 4;
+    prog.run_instruction(0xD120);
+    REQUIRE(state.regs[0xF] == 0);
+    REQUIRE(display.get_pixel(10, 4));
+    REQUIRE(display.get_pixel(17, 19));
+    REQUIRE_FALSE(display.get_pixel(18, 19));
+    REQUIRE_FALSE(display.get_pixel(10, 20));
+    prog.run_instruction(0xD120);
+    REQUIRE(state.regs[0xF] == 1);
+    REQUIRE_FALSE(display.get_pixel(10, 4));
+}
+
+
+TEST_CASE("XO-CHIP addresses 64 KB, two planes and an audio pattern", "[quirks]"){
+    auto prog = CHIP8::Interpreter();
+    REQUIRE(prog.get_xo_chip() == nullptr);
+    prog.set_profile(CHIP8::Profile::XO_CHIP);
+    REQUIRE(prog.get_xo_chip() != nullptr);
+    auto& xo = *prog.get_xo_chip();
+    auto& state = prog.get_state();
+    auto& display = prog.get_framebuffer();
+
+    // F000 nnnn loads a 16-bit address, which Fx55 and Fx65 reach
+    prog.load_bytes({0xF0, 0x00, 0x80, 0x00, 0x60, 0x2A, 0xF0, 0x55, 0x61, 0x00, 0xF1, 0x65});
+    prog.run_instructions(3);
+    REQUIRE(state.pc == 0x208);
+    REQUIRE(xo.at(state, 0x8000) == 0x2A);
+    REQUIRE(xo.high_ram[0x7000] == 0x2A);
+    state.regs[0x0] = 0;
+    state.Ireg = 0x8000;
+    prog.run_instructions(2);
+    REQUIRE(state.regs[0x0] == 0x2A);
+    REQUIRE(state.regs[0x1] == 0x00);
+
+    // Skips step over a whole F000 nnnn
+    prog.reset();
+    prog.load_bytes({0x30, 0x00, 0xF0, 0x00, 0x12, 0x34, 0x00, 0xE0});
+    prog.run_instructions(1);
+    REQUIRE(state.pc == 0x206);
+
+    // Programs larger than 4 KB continue past it
+    std::vector<CHIP8::byte_t> large(0x1000, 0x00);
+    large.back() = 0x77;
+    prog.load_bytes(large);
+    REQUIRE(xo.at(state, 0x11FF) == 0x77);
+
+    // 5xy2 and 5xy3 save and load Vx-Vy, in either order, leaving I
+    state.Ireg = 0x400;
+    state.regs[0x3] = 3;
+    state.regs[0x4] = 4;
+    state.regs[0x5] = 5;
+    prog.run_instruction(0x5352);
+    REQUIRE(state.Ireg == 0x400);
+    REQUIRE(state.ram[0x400] == 3);
+    REQUIRE(state.ram[0x402] == 5);
+    prog.run_instruction(0x5533);
+    REQUIRE(state.regs[0x5] == 3);
+    REQUIRE(state.regs[0x4] == 4);
+    REQUIRE(state.regs[0x3] == 5);
+
+    // Fn01 selects the planes sprites are drawn to, each with its own data
+    state.ram[0x400] = 0x80;
+    state.ram[0x401] = 0x40;
+    state.regs[0x0] = 0;
+    prog.run_instruction(0xF201);
+    prog.run_instruction(0xD001);
+    REQUIRE_FALSE(display.get_pixel(0, 0));
+    REQUIRE(xo.plane.get_pixel(0, 0));
+    prog.run_instruction(0xF301);
+    prog.run_instruction(0xD001);
+    REQUIRE(state.regs[0xF] == 0);
+    REQUIRE(display.get_pixel(0, 0));
+    REQUIRE(xo.plane.get_pixel(0, 0));
+    REQUIRE(xo.plane.get_pixel(1, 0));
+    prog.run_instruction(0xD001);
+    REQUIRE(state.regs[0xF] == 1);
+    REQUIRE_FALSE(display.get_pixel(0, 0));
+    REQUIRE_FALSE(xo.plane.get_pixel(1, 0));
+    prog.run_instruction(0xD001);
+    prog.run_instruction(0xF101);
+    prog.run_instruction(0x00E0);
+    REQUIRE_FALSE(display.get_pixel(0, 0));
+    REQUIRE(xo.plane.get_pixel(1, 0));
+
+    // F002 loads the audio pattern and Fx3A its pitch
+    std::fill_n(state.ram.begin() + 0x400, CHIP8::AUDIO_PATTERN_SIZE, 0xF0);
+    prog.run_instruction(0xF002);
+    REQUIRE(xo.pattern[CHIP8::AUDIO_PATTERN_SIZE - 1] == 0xF0);
+    REQUIRE(xo.get_sample_rate() == 4000.0);
+    state.regs[0x0] = 112;
+    prog.run_instruction(0xF03A);
+    REQUIRE(xo.get_sample_rate() == 8000.0);
+
+    // Without XO-CHIP, 5xy2 is 5xy0 and the memory is freed
+    prog.set_profile(CHIP8::Profile::SCHIP);
+    REQUIRE(prog.get_xo_chip() == nullptr);
+    state.pc = 0x200;
+    state.regs[0x1] = state.regs[0x2] = 9;
+    prog.run_instruction(0x5122);
+    REQUIRE(state.pc == 0x202);
+}
+
+
+/*
+Runs every opcode (except Cxkk, whose random numbers differ between
+interpreters) followed by a jump on the given engine and on the switch engine,
+and checks that the state and framebuffer match afterwards.
+*/
+static void require_same_as_switch_engine(CHIP8::Interpreter& tested){
+    auto reference = CHIP8::Interpreter();
+    reference.set_profile(tested.get_profile());
+
+    // Arbitrary but valid starting state
+    CHIP8::State initial = reference.get_state();
+    for(CHIP8::byte_t i = 0; i != CHIP8::REGISTER_NUM; ++i){
+        initial.regs[i] = CHIP8::byte_t(i * 37 + 11);
+    }
+    initial.Ireg  = 0x300;
+    initial.DTreg = 0x12;
+    initial.STreg = 0x34;
+    initial.sp    = 2;
+    initial.stack[0] = 0x222;
+    initial.stack[1] = 0x244;
+    initial.pc    = 0x400;
+    initial.ram[0x402] = 0x14; // Jump back to 0x400
+    initial.ram[0x403] = 0x00;
+    CHIP8::Framebuffer display;
+    display.draw_byte(initial.regs[0x0], initial.regs[0x1], 0xAA);
+
+    for(uint32_t code = 0x0; code != 0x10000; ++code){
+        if((code & 0xF000) == 0xC000){
+            continue;
+        }
+        CHIP8::Fault faults[2];
+        CHIP8::Interpreter* vms[2] = {&reference, &tested};
+        for(int i = 0; i != 2; ++i){
+            CHIP8::State& state = vms[i]->get_state();
+            state = initial;
+            state.ram[0x400] = CHIP8::byte_t(code >> 8);
+            state.ram[0x401] = CHIP8::byte_t(code);
+            vms[i]->invalidate_decoded(0x400, 2);
+            vms[i]->get_framebuffer() = display;
+            vms[i]->clear_fault();
+            vms[i]->run_instructions(2);
+            faults[i] = vms[i]->get_fault();
+        }
+
+        const CHIP8::State& a = reference.get_state();
+        const CHIP8::State& b = tested.get_state();
+        bool same = faults[0].trap == faults[1].trap && faults[0].pc == faults[1].pc
+            && a.pc == b.pc && a.sp == b.sp && a.Ireg == b.Ireg
+            && a.DTreg == b.DTreg && a.STreg == b.STreg
+            && a.regs == b.regs && a.rpl == b.rpl && a.stack == b.stack && a.ram == b.ram;
+        for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+            for(int word = 0; word != 2; ++word){
+                same &= reference.get_framebuffer().get_row(y, word) == tested.get_framebuffer().get_row(y, word);
+            }
+        }
+        if(!same){
+            FAIL("Engines differ on opcode " << std::hex << code);
+        }
+    }
+}
+
+
+static const CHIP8::Profile ALL_PROFILES[] = {
+    CHIP8::Profile::DEFAULT, CHIP8::Profile::COSMAC_VIP, CHIP8::Profile::CHIP48,
+    CHIP8::Profile::SCHIP, CHIP8::Profile::XO_CHIP,
+};
+
+
+TEST_CASE("Threaded engine matches the switch engine on every opcode", "[engine]"){
+    for(CHIP8::Profile profile : ALL_PROFILES){
+        auto prog = CHIP8::Interpreter();
+        prog.set_profile(profile);
+        prog.set_engine(CHIP8::Engine::THREADED);
+        require_same_as_switch_engine(prog);
+    }
+}
+
+
+#if defined(CHIP8_JIT)
+TEST_CASE("JIT engine matches the switch engine on every opcode", "[engine]"){
+    for(CHIP8::Profile profile : ALL_PROFILES){
+        auto prog = CHIP8::Interpreter();
+        prog.set_engine(CHIP8::Engine::JIT);
+        prog.set_profile(profile);
+        prog.set_jit_threshold(1); // Compile every block on first use
+        require_same_as_switch_engine(prog);
+    }
+}
+
+
+TEST_CASE("JIT engine runs self-modifying loops like the switch engine", "[engine]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0x60, 0x00, // 0x200: V0 = 0
+        0x61, 0x05, // 0x202: V1 = 5
+        0x70, 0x01, // 0x204: V0 += 1
+        0x81, 0x04, // 0x206: V1 += V0, VF = carry
+        0x82, 0x13, // 0x208: V2 ^= V1
+        0x83, 0x0E, // 0x20A: V3 = V0 << 1
+        0x30, 0x40, // 0x20C: Skip if V0 == 0x40
+        0x12, 0x04, // 0x20E: Jump to 0x204
+        0x80, 0x23, // 0x210: V0 ^= V2
+        0x64, 0x01, // 0x212: V4 = 1
+        0x80, 0x41, // 0x214: V0 |= V4, odd steps always reach 0x40
+        0xA2, 0x05, // 0x216: I = 0x205 (operand of the ADD at 0x204)
+        0xF0, 0x55, // 0x218: Store V0 at 0x205
+        0x12, 0x00, // 0x21A: Jump to 0x200
+    };
+
+    auto reference = CHIP8::Interpreter();
+    auto jit = CHIP8::Interpreter();
+    jit.set_engine(CHIP8::Engine::JIT);
+    reference.load_bytes(program);
+    jit.load_bytes(program);
+
+    reference.run_instructions(100000);
+    jit.run_instructions(100000);
+
+    const CHIP8::State& a = reference.get_state();
+    const CHIP8::State& b = jit.get_state();
+    REQUIRE(a.pc == b.pc);
+    REQUIRE(a.Ireg == b.Ireg);
+    REQUIRE(a.regs == b.regs);
+    REQUIRE(a.ram == b.ram);
+}
+#endif
+
+
+TEST_CASE("Every engine halts on the instruction that faults", "[engine]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0x60, 0x05, // 0x200: V0 = 5
+        0x22, 0x06, // 0x202: Call 0x206
+        0x12, 0x04, // 0x204: Not reached
+        0x70, 0x01, // 0x206: V0 += 1
+        0x22, 0x06, // 0x208: Call 0x206 until the stack overflows
+    };
+    std::vector<CHIP8::Engine> engines = {CHIP8::Engine::SWITCH, CHIP8::Engine::THREADED};
+#if defined(CHIP8_JIT)
+    engines.push_back(CHIP8::Engine::JIT);
+#endif
+    for(CHIP8::Engine engine : engines){
+        auto prog = CHIP8::Interpreter();
+        prog.set_engine(engine);
+        prog.set_jit_threshold(1);
+        prog.load_bytes(program);
+
+        // Every successful call but the first follows an addition
+        REQUIRE(prog.run_instructions(1000) == 2 * CHIP8::STACK_SIZE - 1);
+        const CHIP8::Fault& fault = prog.get_fault();
+        REQUIRE(fault.trap == CHIP8::Trap::STACK_OVERFLOW);
+        REQUIRE(fault.pc == 0x208);
+        REQUIRE(fault.opcode == 0x2206);
+        REQUIRE(CHIP8::describe_fault(fault) == "Stack overflow: subroutine call limit reached at 0x0208 (opcode 0x2206)");
+
+        // The faulting call had no effect and nothing runs until the fault is cleared
+        const CHIP8::State& state = prog.get_state();
+        REQUIRE(state.pc == 0x208);
+        REQUIRE(state.sp == CHIP8::STACK_SIZE - 1);
+        REQUIRE(state.regs[0x0] == 5 + CHIP8::STACK_SIZE - 1);
+        REQUIRE(prog.run_instructions(1000) == 0);
+        REQUIRE(prog.run_frame() == 0);
+        prog.reset();
+        REQUIRE_FALSE(prog.get_fault());
+    }
+
+    // Running off the end of RAM faults on the fetch
+    auto prog = CHIP8::Interpreter();
+    prog.get_state().pc = CHIP8::RAM_SIZE - 4;
+    REQUIRE(prog.run_instructions(10) == 1);
+    REQUIRE(prog.get_fault().trap == CHIP8::Trap::PC_OUT_OF_RANGE);
+    REQUIRE(prog.get_fault().pc == CHIP8::RAM_SIZE - 2);
+    REQUIRE(prog.get_state().pc == CHIP8::RAM_SIZE - 2);
+}
+
+
+TEST_CASE("Batched instances match separate interpreters", "[batch]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0xC0, 0xFF, // 0x200: V0 = random byte
+        0xC1, 0x0F, // 0x202: V1 = random key
+        0xE1, 0x9E, // 0x204: Skip if key V1 is pressed
+        0x12, 0x10, // 0x206: Jump to 0x210
+        0x72, 0x01, // 0x208: V2 += 1
+        0xF2, 0x15, // 0x20A: DT = V2
+        0xA3, 0x00, // 0x20C: I = 0x300
+        0xF2, 0x33, // 0x20E: Store BCD of V2 at I
+        0xF3, 0x07, // 0x210: V3 = DT
+        0x83, 0x04, // 0x212: V3 += V0
+        0x83, 0x16, // 0x214: Shift V3 right
+        0xF3, 0x29, // 0x216: I = sprite of digit V3
+        0xD3, 0x45, // 0x218: Draw it at V3, V4
+        0x22, 0x30, // 0x21A: Call 0x230
+        0x12, 0x00, // 0x21C: Jump to 0x200
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x8E, 0x05, // 0x230: VE -= V0
+        0x3E, 0x00, // 0x232: Skip if VE == 0
+        0x74, 0x01, // 0x234: V4 += 1
+        0x00, 0xEE, // 0x236: Return
+    };
+    const uint64_t frames = 40;
+    const uint64_t instructions_per_frame = 37;
+
+    // Half the instances share a seed and keys, so they stay in lockstep
+    std::vector<CHIP8::BatchInstance> instances;
+    for(uint32_t i = 0; i != 48; ++i){
+        CHIP8::BatchInstance instance{(i % 2) ? i : 7u, {}};
+        for(uint64_t frame = 0; frame != frames; ++frame){
+            instance.keys.push_back(uint16_t((i % 2) ? (frame * 7919 * (i + 1)) : 0x00F0));
+        }
+        instances.push_back(instance);
+    }
+
+    for(CHIP8::Profile profile : {CHIP8::Profile::DEFAULT, CHIP8::Profile::COSMAC_VIP}){
+        CHIP8::Batch batch(program, instances, profile);
+        batch.run_frames(frames, instructions_per_frame);
+        REQUIRE(batch.get_frame() == frames);
+
+        for(std::size_t lane = 0; lane != batch.size(); ++lane){
+            auto prog = CHIP8::Interpreter();
+            auto& keypad = static_cast<CHIP8::HeadlessRenderer&>(prog.get_renderer());
+            prog.set_profile(profile);
+            prog.seed(instances[lane].seed);
+            prog.load_bytes(program);
+            for(uint64_t frame = 0; frame != frames; ++frame){
+                for(CHIP8::byte_t key = 0; key != 0x10; ++key){
+                    keypad.set_key(key, (instances[lane].keys[frame] >> key) & 0x1);
+                }
+                prog.run_instructions(instructions_per_frame);
+                prog.update_timers(1000.0 / 60.0);
+            }
+
+            const CHIP8::State& expected = prog.get_state();
+            const CHIP8::State actual = batch.get_state(lane);
+            REQUIRE(batch.get_fault(lane) == nullptr);
+            REQUIRE(actual.pc == expected.pc);
+            REQUIRE(actual.sp == expected.sp);
+            REQUIRE(actual.Ireg == expected.Ireg);
+            REQUIRE(actual.DTreg == expected.DTreg);
+            REQUIRE(actual.STreg == expected.STreg);
+            REQUIRE(actual.regs == expected.regs);
+            REQUIRE(actual.stack == expected.stack);
+            REQUIRE(actual.ram == expected.ram);
+            for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+                REQUIRE(batch.get_framebuffer(lane).get_row(y) == prog.get_framebuffer().get_row(y));
+            }
+        }
+    }
+}
+
+
+TEST_CASE("Batched instances fault independently", "[batch]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0xC0, 0x01, // 0x200: V0 = random bit
+        0x30, 0x00, // 0x202: Skip if V0 == 0
+        0x00, 0xEE, // 0x204: Return without a call
+        0x12, 0x00, // 0x206: Jump to 0x200
+    };
+    std::vector<CHIP8::BatchInstance> instances;
+    for(uint32_t seed = 1; seed != 33; ++seed){
+        instances.push_back({seed, {}});
+    }
+    CHIP8::Batch batch(program, instances);
+    batch.run_frames(10, 100);
+
+    std::size_t faulted = 0;
+    for(std::size_t lane = 0; lane != batch.size(); ++lane){
+        if(batch.get_fault(lane) != nullptr){
+            REQUIRE(std::string(batch.get_fault(lane)) == "No subroutine to return from");
+            faulted++;
+        }
+
+        // Faulted instances are left on the faulting instruction, as an Interpreter is
+        auto prog = CHIP8::Interpreter();
+        prog.seed(instances[lane].seed);
+        prog.load_bytes(program);
+        prog.run_instructions(1000);
+        REQUIRE(prog.get_fault());
+        REQUIRE(batch.get_state(lane).pc == prog.get_state().pc);
+        REQUIRE(batch.get_state(lane).pc == 0x204);
+        REQUIRE(batch.get_state(lane).regs == prog.get_state().regs);
+    }
+    REQUIRE(faulted == batch.size());
+}
+
+
+TEST_CASE("Input scripts hold each keypad state until the next line", "[runner]"){
+    std::istringstream script(
+        "# frame keys\n"
+        "0 0\n"
+        "2 0010\n"
+        "\n"
+        "4 8001\n"
+    );
+    const CHIP8::KeyTrace trace = CHIP8::parse_key_script(script, 6);
+    REQUIRE(trace == CHIP8::KeyTrace{0x0000, 0x0000, 0x0010, 0x0010, 0x8001, 0x8001});
+}
+
+
+TEST_CASE("Jobs give the same results on any number of workers", "[runner]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0xC0, 0xFF, // 0x200: V0 = random byte
+        0xE0, 0xA1, // 0x202: Skip if key V0 is not pressed
+        0x00, 0xEE, // 0x204: Return without a call, faults
+        0xF0, 0x29, // 0x206: I = sprite of digit V0
+        0xD0, 0x05, // 0x208: Draw it at V0, V0
+        0x12, 0x00, // 0x20A: Jump to 0x200
+    };
+    std::ofstream("runner_test.ch8", std::ios::binary).write(
+        reinterpret_cast<const char*>(program.data()), program.size()
+    );
+
+    std::vector<CHIP8::Job> jobs;
+    for(uint32_t seed = 0; seed != 24; ++seed){
+        CHIP8::Job job;
+        job.rom = "runner_test.ch8";
+        job.frames = 30;
+        job.seed = seed;
+        job.keys = CHIP8::KeyTrace(30, (seed % 3 == 0) ? 0x0004 : 0x0000);
+        jobs.push_back(job);
+    }
+    jobs.push_back(jobs[0]);
+    jobs.back().rom = "missing.ch8";
+
+    std::vector<CHIP8::JobResult> serial(jobs.size());
+    std::vector<CHIP8::JobResult> parallel(jobs.size());
+    CHIP8::run_jobs(jobs, [&](const CHIP8::JobResult& result){ serial[result.index] = result; }, 1);
+    std::size_t reported = 0;
+    CHIP8::run_jobs(jobs, [&](const CHIP8::JobResult& result){
+        parallel[result.index] = result;
+        reported++;
+    }, 4);
+    REQUIRE(reported == jobs.size());
+
+    for(std::size_t i = 0; i != jobs.size(); ++i){
+        REQUIRE(serial[i].index == i);
+        REQUIRE(parallel[i].reason == serial[i].reason);
+        REQUIRE(parallel[i].instructions == serial[i].instructions);
+        REQUIRE(parallel[i].state_hash == serial[i].state_hash);
+        REQUIRE(parallel[i].framebuffer_hash == serial[i].framebuffer_hash);
+    }
+    REQUIRE(serial[1].reason == CHIP8::ExitReason::COMPLETED);
+    REQUIRE(serial[1].instructions >= 30 * 700 / 60 - 1); // Fractional budget carried over
+    REQUIRE(serial[1].instructions <= 30 * 700 / 60);
+    REQUIRE(serial.back().reason == CHIP8::ExitReason::LOAD_FAILED);
+
+    // Pressing key 4 makes the random key match sooner or later
+    bool faulted = false;
+    for(std::size_t i = 0; i < 24; i += 3){
+        faulted |= serial[i].reason == CHIP8::ExitReason::FAULTED;
+    }
+    REQUIRE(faulted);
+
+    // A failing callback stops the pool and reaches the caller once the workers are joined
+    std::size_t before_failure = 0;
+    REQUIRE_THROWS_AS(CHIP8::run_jobs(jobs, [&](const CHIP8::JobResult&){
+        if(++before_failure == 3){
+            throw std::runtime_error("Result could not be stored");
+        }
+    }, 4), std::runtime_error);
+    REQUIRE(before_failure >= 3);
+    REQUIRE(before_failure < jobs.size());
+}
+
+
+TEST_CASE("Timers follow emulated time and keep the remainder", "[timing]"){
+    auto vm = CHIP8::Interpreter();
+    vm.get_state().DTreg = 100;
+    for(int i = 0; i != 10; ++i){
+        vm.update_timers(7.0);
+    }
+    REQUIRE(vm.get_state().DTreg == 96); // 70 ms hold four ticks of 16.7 ms
+
+    // Ticks follow the cycles run rather than the number of frames
+    const std::vector<CHIP8::byte_t> loop = {
+        0x70, 0x01, // 0x200: V0 += 1
+        0x12, 0x00, // 0x202: Jump to 0x200
+    };
+    for(CHIP8::Timing timing : {CHIP8::Timing::UNIFORM, CHIP8::Timing::COSMAC_VIP}){
+        auto prog = CHIP8::Interpreter();
+        prog.set_timing(timing);
+        prog.set_clock_speed((timing == CHIP8::Timing::UNIFORM) ? 650.0 : CHIP8::COSMAC_VIP_CYCLE_RATE);
+        prog.load_bytes(loop);
+        prog.get_state().DTreg = 100;
+        uint64_t executed = 0;
+        for(int frame = 0; frame != 45; ++frame){
+            executed += prog.run_frame();
+        }
+        // At 650 Hz, 487 whole cycles fit in 45 frames, 749 ms.
+        // With VIP timing, the last instruction overruns 750 ms.
+        REQUIRE(prog.get_state().DTreg == ((timing == CHIP8::Timing::UNIFORM) ? 56 : 55));
+
+        const CHIP8::CycleCosts& costs = prog.get_cycle_costs();
+        const double lap = costs.op[std::size_t(CHIP8::Op::ADD_BYTE)] + costs.op[std::size_t(CHIP8::Op::JP)];
+        const double expected = 0.75 * 2.0 * prog.get_clock_speed() / lap;
+        REQUIRE(executed >= expected - 2);
+        REQUIRE(executed <= expected + 2);
+    }
+    REQUIRE(CHIP8::parse_timing("vip") == CHIP8::Timing::COSMAC_VIP);
+    REQUIRE_THROWS(CHIP8::parse_timing("fast"));
+
+    // Costs may add up past 16 bits, here a store of two registers takes more than a frame
+    CHIP8::CycleCosts costs = CHIP8::get_cycle_costs(CHIP8::Timing::UNIFORM);
+    costs.per_register = 0x8000;
+    auto slow = CHIP8::Interpreter();
+    slow.set_cycle_costs(costs);
+    slow.set_clock_speed(0x10000 * CHIP8::Interpreter::FRAME_RATE);
+    slow.load_bytes({
+        0xA3, 0x00, // 0x200: I = 0x300
+        0xF1, 0x55, // 0x202: Store V0 and V1
+        0x12, 0x00, // 0x204: Jump to 0x200
+    });
+    REQUIRE(slow.run_frame() == 2);
+}
+
+TEST_CASE("Timer ticks are applied when the timers are read", "[timing]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0xF0, 0x07, // 0x200: V0 = DT
+        0xF1, 0x18, // 0x202: ST = V1
+        0x12, 0x00, // 0x204: Jump to 0x200
+    };
+    auto vm = CHIP8::Interpreter();
+    vm.load_bytes(program);
+    vm.get_state().DTreg = 200;
+    vm.get_state().regs[1] = 3;
+
+    // Timers are compared with ticks applied one at a time, as they elapse
+    const double period = 1000.0 / 60.0;
+    double elapsed = 0.0;
+    int delay = 200;
+    int sound = 3;
+    for(int step = 0; step != 40; ++step){
+        const double dt = 3.0 + (step * 7) % 50;
+        vm.update_timers(dt);
+        elapsed += dt;
+        while(elapsed >= period){
+            elapsed -= period;
+            delay = std::max(delay - 1, 0);
+            sound = std::max(sound - 1, 0);
+        }
+        if(step % 3 == 0){
+            vm.run_instructions(3);
+            REQUIRE(vm.get_state().regs[0] == delay);
+            sound = 3;
+        }
+        REQUIRE(vm.get_delay_timer() == delay);
+        REQUIRE(vm.get_sound_timer() == sound);
+    }
+
+    // Ticks beyond the value of a timer stop it at zero
+    vm.update_timers(5000.0);
+    REQUIRE(vm.get_delay_timer() == 0);
+    REQUIRE(vm.get_state().STreg == 0);
+}
+
+
+TEST_CASE("Programs read and write the ticked timers with every timing", "[timing]"){
+    for(CHIP8::Timing timing : {CHIP8::Timing::UNIFORM, CHIP8::Timing::COSMAC_VIP}){
+        const double clock = (timing == CHIP8::Timing::UNIFORM) ? 700.0 : CHIP8::COSMAC_VIP_CYCLE_RATE;
+
+        // Frames read DT as it was when they started, at most a couple of ticks before the end
+        auto reader = CHIP8::Interpreter();
+        reader.set_timing(timing);
+        reader.set_clock_speed(clock);
+        reader.load_bytes({
+            0x6A, 0x3C, // 0x200: VA = 60
+            0xFA, 0x15, // 0x202: DT = VA
+            0xFB, 0x07, // 0x204: VB = DT
+            0x12, 0x04, // 0x206: Jump to 0x204
+        });
+        for(int frame = 0; frame != 30; ++frame){
+            reader.run_frame();
+        }
+        const int read = reader.get_state().regs[0xB];
+        const int delay = reader.get_delay_timer();
+        REQUIRE(read < 60);
+        REQUIRE(read >= delay);
+        REQUIRE(read <= delay + 2);
+
+        // Ticks from earlier frames are not taken off a value written since
+        auto writer = CHIP8::Interpreter();
+        writer.set_timing(timing);
+        writer.set_clock_speed(clock);
+        writer.load_bytes({
+            0x6A, 0x3C, // 0x200: VA = 60
+            0xFA, 0x15, // 0x202: DT = VA
+            0x12, 0x02, // 0x204: Jump to 0x202
+        });
+        for(int frame = 0; frame != 30; ++frame){
+            writer.run_frame();
+        }
+        REQUIRE(writer.get_delay_timer() >= 58);
+    }
+}
+
+
+static void require_same_machine(CHIP8::Interpreter& a, CHIP8::Interpreter& b){
+    REQUIRE(a.get_state().pc == b.get_state().pc);
+    REQUIRE(a.get_state().sp == b.get_state().sp);
+    REQUIRE(a.get_state().Ireg == b.get_state().Ireg);
+    REQUIRE(a.get_state().DTreg == b.get_state().DTreg);
+    REQUIRE(a.get_state().regs == b.get_state().regs);
+    REQUIRE(a.get_state().stack == b.get_state().stack);
+    REQUIRE(a.get_state().ram == b.get_state().ram);
+    for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+        REQUIRE(a.get_framebuffer().get_row(y) == b.get_framebuffer().get_row(y));
+    }
+}
+
+static void run_snapshot_frames(CHIP8::Interpreter& vm, int frames){
+    for(int frame = 0; frame != frames; ++frame){
+        vm.run_instructions(101);
+        vm.update_timers(1000.0 / 60.0);
+    }
+}
+
+static const std::vector<CHIP8::byte_t> SNAPSHOT_PROGRAM = {
+    0xC0, 0x0F, // 0x200: V0 = random digit
+    0xA2, 0x0B, // 0x202: I = 0x20B
+    0xF0, 0x55, // 0x204: Store V0 as the operand of the ADD below
+    0xF0, 0x29, // 0x206: I = sprite of digit V0
+    0xD1, 0x25, // 0x208: Draw it at V1, V2
+    0x71, 0x00, // 0x20A: V1 += random digit
+    0xF1, 0x15, // 0x20C: DT = V1
+    0x12, 0x00, // 0x20E: Jump to 0x200
+};
+
+
+TEST_CASE("Loading a snapshot resumes exactly where it was saved", "[snapshot]"){
+    REQUIRE(sizeof(CHIP8::Snapshot) < 5376);
+
+    auto vm = CHIP8::Interpreter();
+    vm.seed(5);
+    vm.load_bytes(SNAPSHOT_PROGRAM);
+    run_snapshot_frames(vm, 10);
+    CHIP8::Snapshot snapshot;
+    vm.save_state(snapshot);
+
+    auto expected = CHIP8::Interpreter();
+    expected.load_state(snapshot);
+    run_snapshot_frames(expected, 10);
+
+    // Going back rewrites the modified operand, so its decoded copy must be refreshed
+    run_snapshot_frames(vm, 7);
+    vm.load_state(snapshot);
+    run_snapshot_frames(vm, 10);
+    require_same_machine(vm, expected);
+
+    auto threaded = CHIP8::Interpreter();
+    threaded.set_engine(CHIP8::Engine::THREADED);
+    threaded.load_bytes({0x12, 0x00});
+    run_snapshot_frames(threaded, 1);
+    threaded.load_state(snapshot);
+    run_snapshot_frames(threaded, 10);
+    require_same_machine(threaded, expected);
+
+    CHIP8::Snapshot corrupted = snapshot;
+    corrupted.header.version++;
+    REQUIRE_THROWS(vm.load_state(corrupted));
+
+    // Padding is written as zeros whatever the snapshot held before
+    CHIP8::Snapshot cleared, dirty;
+    std::memset(static_cast<void*>(&cleared), 0x00, sizeof(CHIP8::Snapshot));
+    std::memset(static_cast<void*>(&dirty), 0xFF, sizeof(CHIP8::Snapshot));
+    vm.save_state(cleared);
+    vm.save_state(dirty);
+    REQUIRE(std::memcmp(&cleared, &dirty, sizeof(CHIP8::Snapshot)) == 0);
+}
+
+
+TEST_CASE("Snapshot files hold one or more snapshots", "[snapshot]"){
+    auto vm = CHIP8::Interpreter();
+    vm.seed(9);
+    vm.load_bytes(SNAPSHOT_PROGRAM);
+    std::vector<uint16_t> pcs;
+    for(int i = 0; i != 3; ++i){
+        run_snapshot_frames(vm, 3);
+        CHIP8::Snapshot snapshot;
+        vm.save_state(snapshot);
+        CHIP8::write_snapshot("snapshot_test.c8s", snapshot, i != 0);
+        pcs.push_back(vm.get_state().pc);
+    }
+
+    {
+        const CHIP8::SnapshotFile library("snapshot_test.c8s");
+        REQUIRE(library.size() == 3);
+        for(std::size_t i = 0; i != library.size(); ++i){
+            REQUIRE(library[i].state.pc == pcs[i]);
+        }
+    }
+
+    vm.save_state("snapshot_test.c8s");
+    auto restored = CHIP8::Interpreter();
+    restored.load_state("snapshot_test.c8s");
+    run_snapshot_frames(vm, 5);
+    run_snapshot_frames(restored, 5);
+    require_same_machine(vm, restored);
+
+    std::ofstream("snapshot_test.c8s", std::ios::binary).write("C8SS", 4);
+    REQUIRE_THROWS(CHIP8::SnapshotFile("snapshot_test.c8s"));
+    REQUIRE_THROWS(restored.load_state("missing.c8s"));
+    std::remove("snapshot_test.c8s");
+}
+
+
+TEST_CASE("ROMs load from mapped files and their analysis is cached by hash", "[predecode]"){
+    std::ofstream("predecode_test.ch8", std::ios::binary).write(
+        reinterpret_cast<const char*>(SNAPSHOT_PROGRAM.data()), SNAPSHOT_PROGRAM.size()
+    );
+    const CHIP8::MappedFile file("predecode_test.ch8");
+    REQUIRE(file.size() == SNAPSHOT_PROGRAM.size());
+    REQUIRE(std::equal(SNAPSHOT_PROGRAM.begin(), SNAPSHOT_PROGRAM.end(), file.data()));
+    REQUIRE_THROWS(CHIP8::MappedFile("missing.ch8"));
+
+    const CHIP8::Predecode analysis = CHIP8::predecode(file.data(), file.size());
+    REQUIRE(analysis.rom_hash == CHIP8::hash_rom(SNAPSHOT_PROGRAM));
+    REQUIRE(analysis.decoded[0x208 >> 1].op == CHIP8::Op::DRW);
+    REQUIRE(analysis.decoded[0x210 >> 1].op == CHIP8::Op::UNDECODED);
+
+    // The first lookup analyses and writes, the next reads
+    const CHIP8::PredecodeCache cache(".");
+    const std::string entry = cache.path(analysis.rom_hash);
+    std::remove(entry.c_str());
+    bool hit = true;
+    cache.get(file.data(), file.size(), &hit);
+    REQUIRE_FALSE(hit);
+    const CHIP8::Predecode cached = cache.get(file.data(), file.size(), &hit);
+    REQUIRE(hit);
+    REQUIRE(cached.rom_hash == analysis.rom_hash);
+    REQUIRE(cached.decoded[0x208 >> 1].code == 0xD125);
+
+    // Entries written with other operations, or damaged, are analysed again
+    CHIP8::Predecode stale = cached;
+    stale.header.op_count++;
+    std::ofstream(entry, std::ios::binary).write(reinterpret_cast<const char*>(&stale), sizeof(stale));
+    cache.get(file.data(), file.size(), &hit);
+    REQUIRE_FALSE(hit);
+    CHIP8::Predecode damaged = cached;
+    damaged.decoded[0x208 >> 1].op = CHIP8::Op::COUNT;
+    REQUIRE_FALSE(damaged.is_valid());
+    std::ofstream(entry, std::ios::binary).write(reinterpret_cast<const char*>(&damaged), sizeof(damaged));
+    cache.get(file.data(), file.size(), &hit);
+    REQUIRE_FALSE(hit);
+    cache.get(file.data(), file.size(), &hit);
+    REQUIRE(hit);
+
+    // The program rewrites its own code, which must win over the analysis
+    auto from_file = CHIP8::Interpreter();
+    from_file.seed(9);
+    from_file.load_file("predecode_test.ch8");
+    auto predecoded = CHIP8::Interpreter();
+    predecoded.seed(9);
+    predecoded.load_bytes(file.data(), file.size());
+    predecoded.load_predecode(cached);
+    run_snapshot_frames(from_file, 10);
+    run_snapshot_frames(predecoded, 10);
+    require_same_machine(from_file, predecoded);
+
+    std::remove("predecode_test.ch8");
+    std::remove(entry.c_str());
+}
+
+
+TEST_CASE("Static analysis finds routines, sprites, indirect jumps and stores over code", "[analysis]"){
+    const std::vector<CHIP8::byte_t> program = {
+        0x22, 0x08, // 0x200: Call 0x208
+        0xA2, 0x0E, // 0x202: I = 0x20E
+        0xD0, 0x15, // 0x204: Draw the sprite at I
+        0xB2, 0x00, // 0x206: Jump to 0x200 + V0
+        0xA2, 0x00, // 0x208: I = 0x200
+        0xF0, 0x33, // 0x20A: Store the digits of V0 over the call
+        0x00, 0xEE, // 0x20C: Return
+        0xF0, 0x90, 0xF0, 0x90, 0x90, // 0x20E: Sprite of 'A'
+    };
+    std::array<CHIP8::byte_t, CHIP8::RAM_SIZE> ram{};
+    std::copy(program.begin(), program.end(), ram.begin() + CHIP8::RAM_PROG_OFFSET);
+    const uint16_t limit = uint16_t(CHIP8::RAM_PROG_OFFSET + program.size());
+    const CHIP8::ProgramMap map = CHIP8::analyse_program(ram, CHIP8::RAM_PROG_OFFSET, limit);
+
+    REQUIRE(map.routines.size() == 2);
+    REQUIRE(map.routines.at(0x200).callees == std::set<uint16_t>{0x208});
+    REQUIRE(map.routines.at(0x208).blocks == std::vector<uint16_t>{0x208});
+    REQUIRE(map.routines.at(0x208).callees.empty());
+    for(uint16_t addr = 0x20E; addr != 0x213; ++addr){
+        REQUIRE(map.sprites[addr]);
+        REQUIRE_FALSE(map.code.instructions[addr]);
+    }
+    REQUIRE_FALSE(map.sprites[0x204]);
+    REQUIRE(map.indirect_jumps == std::set<uint16_t>{0x206});
+    REQUIRE(map.self_modifying == std::set<uint16_t>{0x20A});
+
+    REQUIRE(CHIP8::disassemble(CHIP8::decode(0xD015)) == "DRW V0, V1, 5");
+    REQUIRE(CHIP8::disassemble(CHIP8::decode(0x8AB4)) == "ADD VA, VB");
+    REQUIRE(CHIP8::disassemble(CHIP8::decode(0xE1A1)) == "SKNP V1");
+
+    std::stringstream listing;
+    CHIP8::write_listing(listing, ram, map, CHIP8::RAM_PROG_OFFSET, limit);
+    REQUIRE(listing.str().find("; Entry point, calls 0x208\n") != std::string::npos);
+    REQUIRE(listing.str().find("206  B200  JP V0, 0x200        ; Indirect jump\n") != std::string::npos);
+    REQUIRE(listing.str().find("20A  F033  LD B, V0            ; Stores over code\n") != std::string::npos);
+    REQUIRE(listing.str().find("20F  90    DB 0x90             ; #..#....\n") != std::string::npos);
+
+    std::stringstream blocks;
+    CHIP8::write_block_list(blocks, map);
+    std::string line;
+    std::size_t count = 0;
+    while(std::getline(blocks, line)){
+        count++;
+    }
+    REQUIRE(count == map.code.blocks.size());
+    REQUIRE(blocks.str().find("{\"start\": 514, \"end\": 520, \"successors\": [], \"dynamic\": true") != std::string::npos);
+
+    // Nothing runs after 00FD, so the data behind it is not code being stored over
+    const std::vector<CHIP8::byte_t> exiting = {
+        0xA2, 0x06, // 0x200: I = 0x206
+        0xF0, 0x33, // 0x202: Store the digits of V0 at I
+        0x00, 0xFD, // 0x204: Exit
+        0x00, 0x00, 0x00, // 0x206: Digits
+    };
+    ram.fill(0);
+    std::copy(exiting.begin(), exiting.end(), ram.begin() + CHIP8::RAM_PROG_OFFSET);
+    const CHIP8::ProgramMap exited = CHIP8::analyse_program(
+        ram, CHIP8::RAM_PROG_OFFSET, uint16_t(CHIP8::RAM_PROG_OFFSET + exiting.size())
+    );
+    REQUIRE(exited.code.instructions[0x204]);
+    REQUIRE_FALSE(exited.code.instructions[0x206]);
+    REQUIRE(exited.code.blocks.at(0x200).successors.empty());
+    REQUIRE(exited.self_modifying.empty());
+}
+
+
+TEST_CASE("A triple buffer always hands over the newest complete value", "[present]"){
+    CHIP8::TripleBuffer<std::array<uint64_t, 64>> buffer;
+    REQUIRE_FALSE(buffer.take());
+
+    constexpr uint64_t COUNT = 100000;
+    std::thread producer([&](){
+        for(uint64_t i = 1; i <= COUNT; ++i){
+            buffer.back().fill(i);
+            buffer.publish();
+        }
+    });
+    uint64_t last = 0;
+    bool torn = false, older = false;
+    while(last != COUNT){
+        if(buffer.take()){
+            const std::array<uint64_t, 64>& value = buffer.front();
+            torn |= !std::all_of(value.begin(), value.end(), [&](uint64_t v){ return v == value[0]; });
+            older |= (value[0] <= last);
+            last = value[0];
+        }
+    }
+    producer.join();
+    REQUIRE_FALSE(torn);
+    REQUIRE_FALSE(older);
+    REQUIRE_FALSE(buffer.take());
+}
+
+/* Closes after a number of updates, counting those with a changed display */
+class ClosingRenderer : public CHIP8::HeadlessRenderer {
+    int m_updates;
+
+public:
+    int changed = 0;
+
+    explicit ClosingRenderer(int updates) : m_updates(updates) { }
+
+    double update(const CHIP8::Framebuffer& framebuffer) override {
+        changed += (framebuffer.get_dirty_rows() != 0);
+        if(--m_updates == 0){
+            close();
+        }
+        return 0.0;
+    }
+    using HeadlessRenderer::update;
+};
+
+TEST_CASE("Programs run on their own thread while the caller presents their frames", "[present]"){
+    auto owned = std::make_unique<ClosingRenderer>(100);
+    ClosingRenderer& renderer = *owned;
+    auto vm = CHIP8::Interpreter(std::move(owned));
+    vm.set_clock_speed(CHIP8::Interpreter::CLOCK_UNTHROTTLED);
+    vm.load_bytes(SNAPSHOT_PROGRAM);
+    vm.run();
+
+    // The emulation thread stops once the renderer closes, having drawn several frames
+    REQUIRE_FALSE(renderer.is_running());
+    REQUIRE(renderer.changed > 1);
+}
+
+
+TEST_CASE("Rewinding returns to each recorded frame in reverse", "[rewind]"){
+    auto vm = CHIP8::Interpreter();
+    vm.seed(3);
+    vm.load_bytes(SNAPSHOT_PROGRAM);
+
+    // Room for 150 frames in groups of 16, so the oldest groups are dropped
+    CHIP8::Rewind rewind(150, 16);
+    std::vector<CHIP8::Snapshot> recorded;
+    for(int frame = 0; frame != 400; ++frame){
+        CHIP8::Snapshot snapshot;
+        vm.save_state(snapshot);
+        rewind.push(snapshot);
+        recorded.push_back(snapshot);
+        run_snapshot_frames(vm, 1);
+    }
+    REQUIRE(rewind.size() >= 150);
+    REQUIRE(rewind.size() < 150 + 2 * 16);
+    REQUIRE(rewind.memory_usage() < rewind.size() * sizeof(CHIP8::Snapshot) / 4);
+
+    // Step back part of the way, then record a different future
+    CHIP8::Snapshot snapshot;
+    for(int frame = 399; frame != 349; --frame){
+        REQUIRE(rewind.pop(snapshot));
+        REQUIRE(std::memcmp(&snapshot, &recorded[frame], sizeof(snapshot)) == 0);
+    }
+    vm.load_state(snapshot);
+    vm.get_renderer().init();
+    static_cast<CHIP8::HeadlessRenderer&>(vm.get_renderer()).set_key(0x5, true);
+    recorded.resize(350);
+    for(int frame = 350; frame != 360; ++frame){
+        vm.save_state(snapshot);
+        rewind.push(snapshot);
+        recorded.push_back(snapshot);
+        run_snapshot_frames(vm, 1);
+    }
+
+    const std::size_t size = rewind.size();
+    for(std::size_t i = 0; i != size; ++i){
+        REQUIRE(rewind.pop(snapshot));
+        REQUIRE(std::memcmp(&snapshot, &recorded[359 - i], sizeof(snapshot)) == 0);
+    }
+    REQUIRE_FALSE(rewind.pop(snapshot));
+
+    // Through the interpreter
+    vm.set_rewind_length(30);
+    REQUIRE_FALSE(vm.rewind_frame());
+    const CHIP8::State start = vm.get_state();
+    for(int frame = 0; frame != 20; ++frame){
+        vm.record_frame();
+        run_snapshot_frames(vm, 1);
+    }
+    for(int frame = 0; frame != 20; ++frame){
+        REQUIRE(vm.rewind_frame());
+    }
+    REQUIRE(vm.get_state().pc == start.pc);
+    REQUIRE(vm.get_state().regs == start.regs);
+    REQUIRE(vm.get_state().ram == start.ram);
+}
+
+
+TEST_CASE("Movies replay a session bit-exactly", "[movie]"){
+    // A session with COSMAC VIP timing, holding keys that change every few frames
+    auto session = CHIP8::Interpreter();
+    auto& keypad = static_cast<CHIP8::HeadlessRenderer&>(session.get_renderer());
+    CHIP8::Movie movie;
+    movie.rom_hash = CHIP8::hash_rom(SNAPSHOT_PROGRAM);
+    movie.seed = 1234;
+    movie.profile = CHIP8::Profile::COSMAC_VIP;
+    movie.clock_speed = CHIP8::COSMAC_VIP_CYCLE_RATE;
+    movie.timing = CHIP8::Timing::COSMAC_VIP;
+    session.set_profile(movie.profile);
+    session.set_clock_speed(movie.clock_speed);
+    session.set_timing(movie.timing);
+    session.seed(movie.seed);
+    session.load_bytes(SNAPSHOT_PROGRAM);
+    for(int frame = 0; frame != 120; ++frame){
+        const uint16_t keys = uint16_t((frame / 7) * 0x1111);
+        for(CHIP8::byte_t key = 0; key != 0x10; ++key){
+            keypad.set_key(key, (keys >> key) & 0x1);
+        }
+        movie.keys.push_back(keys);
+        session.run_frame();
+    }
+
+    std::stringstream file;
+    CHIP8::write_movie(file, movie);
+    const CHIP8::Movie replayed = CHIP8::read_movie(file);
+    REQUIRE(replayed.rom_hash == movie.rom_hash);
+    REQUIRE(replayed.seed == movie.seed);
+    REQUIRE(replayed.profile == movie.profile);
+    REQUIRE(replayed.clock_speed == movie.clock_speed);
+    REQUIRE(replayed.timing == movie.timing);
+    REQUIRE(replayed.keys == movie.keys);
+
+    std::ofstream("movie_test.ch8", std::ios::binary).write(
+        reinterpret_cast<const char*>(SNAPSHOT_PROGRAM.data()), SNAPSHOT_PROGRAM.size()
+    );
+    CHIP8::JobResult result;
+    CHIP8::run_jobs({CHIP8::movie_job(replayed, "movie_test.ch8")}, [&](const CHIP8::JobResult& r){ result = r; }, 1);
+    std::remove("movie_test.ch8");
+
+    REQUIRE(result.reason == CHIP8::ExitReason::COMPLETED);
+    REQUIRE(result.state_hash == CHIP8::hash_state(session.get_state()));
+    REQUIRE(result.framebuffer_hash == CHIP8::hash_framebuffer(session.get_framebuffer()));
+
+    std::istringstream malformed("chip8-movie 1\nrom 0\nseed x\n");
+    REQUIRE_THROWS(CHIP8::read_movie(malformed));
+}
+
+
+#if defined(CHIP8_PROFILE)
+TEST_CASE("Profiler counts operations, addresses and self-modified code", "[profiler]"){
+    auto vm = CHIP8::Interpreter();
+    vm.set_engine(CHIP8::Engine::THREADED);
+    vm.load_bytes({
+        0x22, 0x0A, // 0x200: Call 0x20A
+        0xA2, 0x07, // 0x202: I = 0x207
+        0xF0, 0x55, // 0x204: Store V0 as the operand of the ADD below
+        0x70, 0x01, // 0x206: V0 += 1
+        0x12, 0x00, // 0x208: Jump to 0x200
+        0x00, 0xEE, // 0x20A: Return
+    });
+    vm.enable_profiler();
+    vm.run_instructions(6 * 100);
+
+    const CHIP8::Profiler& profile = *vm.get_profiler();
+    REQUIRE(profile.get_instructions() == 600);
+    REQUIRE(profile.get_op_count(CHIP8::Op::CALL) == 100);
+    REQUIRE(profile.get_op_count(CHIP8::Op::RET) == 100);
+    REQUIRE(profile.get_op_count(CHIP8::Op::LD_STORE) == 100);
+    REQUIRE(profile.get_executed(0x200) == 100);
+    REQUIRE(profile.get_executed(0x20A) == 100);
+    REQUIRE(profile.get_calls(0x20A) == 100);
+    REQUIRE(profile.get_writes(0x207) == 100);
+    REQUIRE(profile.get_code_writes(0x207) == 99); // Not yet run on the first lap
+    REQUIRE(profile.get_code_writes(0x205) == 0);
+
+    std::ostringstream report;
+    profile.write_report(report);
+    REQUIRE(report.str().find("0x200-0x209") != std::string::npos); // The loop
+    REQUIRE(report.str().find("0x207-0x207") != std::string::npos); // The rewritten operand
+}
+#endif
+
+
+// Generated by chip8_aot from test/roms/aot_test.ch8
+extern const CHIP8::CompiledProgram aot_test_default_program;
+extern const CHIP8::CompiledProgram aot_test_vip_program;
+
+TEST_CASE("AOT engine runs translated programs like the switch engine", "[engine]"){
+    // The test ROM draws digits, calls a subroutine and rewrites the
+    // operand of an ADD inside its loop, which disables that block.
+    for(const CHIP8::CompiledProgram* program : {&aot_test_default_program, &aot_test_vip_program}){
+        auto reference = CHIP8::Interpreter();
+        auto compiled = CHIP8::Interpreter();
+        compiled.set_engine(CHIP8::Engine::AOT);
+        reference.set_profile(program->profile);
+        reference.load_bytes(std::vector<CHIP8::byte_t>(program->rom, program->rom + program->rom_size));
+        compiled.load_compiled(*program);
+        REQUIRE(compiled.get_profile() == program->profile);
+        REQUIRE(program->block_count > 0);
+
+        for(int frame = 0; frame != 100; ++frame){
+            reference.run_instructions(997);
+            compiled.run_instructions(997);
+
+            const CHIP8::State& a = reference.get_state();
+            const CHIP8::State& b = compiled.get_state();
+            REQUIRE(a.pc == b.pc);
+            REQUIRE(a.sp == b.sp);
+            REQUIRE(a.Ireg == b.Ireg);
+            REQUIRE(a.regs == b.regs);
+            REQUIRE(a.stack == b.stack);
+            REQUIRE(a.ram == b.ram);
+            for(int y = 0; y != CHIP8::Framebuffer::HEIGHT; ++y){
+                REQUIRE(reference.get_framebuffer().get_row(y) == compiled.get_framebuffer().get_row(y));
+            }
+        }
+    }
+}
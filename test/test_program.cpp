@@ -1,4 +1,5 @@
 #include "../src/chip8/chip8.h"
+#include "../src/chip8/sfml_renderer.h"
 #include <catch2/catch_test_macros.hpp>
 
 
@@ -8,7 +9,7 @@ TEST_CASE("Ensure hex digits are drawn on screen", "[program]"){
         "Press keys 0-9 and A-F and make sure they display on screen"
     << std::endl;
 
-    auto chip8 = CHIP8::Interpreter();
+    auto chip8 = CHIP8::Interpreter(std::make_unique<CHIP8::SFMLRenderer>());
     std::vector<CHIP8::byte_t> data{
         0xF0,0x0A, // Halt execution until key press, and store in V0 (digit to display)
         // 0x61,0x0F, // Set V1 to x position